@@ -0,0 +1,86 @@
+#include "AllocationCounter.h"
+
+#ifdef FABEMD_DEBUG_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Dynamic exception specifications are only valid before C++11, from which noexcept replaces them
+#if __cplusplus < 201103L
+#define FABEMD_THROW_BAD_ALLOC throw(std::bad_alloc)
+#define FABEMD_NO_THROW throw()
+#else
+#define FABEMD_THROW_BAD_ALLOC
+#define FABEMD_NO_THROW noexcept
+#endif
+
+namespace
+{
+    // Incremented atomically, as the workers of a thread pool allocate concurrently
+#ifdef _WIN32
+    volatile LONG allocationCount = 0;
+#else
+    volatile unsigned long allocationCount = 0;
+#endif
+}
+
+void * operator new(std::size_t size) FABEMD_THROW_BAD_ALLOC
+{
+#ifdef _WIN32
+    InterlockedIncrement(&allocationCount);
+#else
+    __sync_fetch_and_add(&allocationCount, 1UL);
+#endif
+    void * pointer = std::malloc(size ? size : 1);
+    if (!pointer)
+    {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void * operator new[](std::size_t size) FABEMD_THROW_BAD_ALLOC
+{
+    return operator new(size);
+}
+
+void operator delete(void * pointer) FABEMD_NO_THROW
+{
+    std::free(pointer);
+}
+
+void operator delete[](void * pointer) FABEMD_NO_THROW
+{
+    std::free(pointer);
+}
+#endif
+
+/**
+ * @brief Tell whether heap allocations are counted.
+ * Counting replaces the global operator new, and is only compiled with FABEMD_DEBUG_ALLOCATIONS.
+ * @return True if heap allocations are counted.
+ */
+bool AllocationCounter::enabled()
+{
+#ifdef FABEMD_DEBUG_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Get the number of heap allocations since the program started.
+ * @return Number of calls to operator new, always 0 when allocations are not counted.
+ */
+unsigned long AllocationCounter::count()
+{
+#ifdef FABEMD_DEBUG_ALLOCATIONS
+    return (unsigned long)allocationCount;
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,11 @@
+#ifndef __ALLOCATION_COUNTER_H__
+#define __ALLOCATION_COUNTER_H__
+
+class AllocationCounter
+{
+public:
+    static bool enabled();
+    static unsigned long count();
+};
+
+#endif // __ALLOCATION_COUNTER_H__
@@ -0,0 +1,129 @@
+#include "Batch.h"
+
+using namespace cimg_library;
+
+/**
+ * @brief Decomposition of one image of a batch, by the plan of the worker running it.
+ * The plan is replaced when the image size changes, so that a worker decomposing images of the
+ * same size keeps its buffers.
+ */
+class Batch::ImageTask : public ThreadPool::Task
+{
+private:
+    Batch & _batch;
+    const CImgList<float> & _inputs;
+    std::vector<CImgList<float> > & _results;
+
+public:
+    ImageTask(Batch & batch, const CImgList<float> & inputs, std::vector<CImgList<float> > & results)
+        : _batch(batch), _inputs(inputs), _results(results)
+    {
+    }
+
+    void run(unsigned int index, unsigned int worker)
+    {
+        const CImg<float> & input = _inputs[index];
+        FABEMDPlan *& plan = _batch._plans[worker];
+        if (!plan || !plan->accepts(input))
+        {
+            delete plan;
+            plan = new FABEMDPlan(input.width(), input.height(), _batch._parameters, input.depth());
+        }
+        plan->execute(input, _results[index]);
+        _batch._residuesKept[index] = plan->residueKept();
+    }
+};
+
+/**
+ * @brief Prepare the decomposition of batches of images sharing the same parameters.
+ * Images are decomposed concurrently, each one on a single worker of the pool, so that a batch
+ * scales with the number of workers whatever the size of its images. Each worker keeps its own
+ * plan between images and batches.
+ * @param parameters Parameters of every decomposition
+ * @param threadPool Pool of workers, which must outlive the batch, or 0 to run on the calling thread
+ */
+Batch::Batch(const FABEMD::Parameters & parameters, ThreadPool * threadPool)
+{
+    _parameters = parameters;
+    _threadPool = threadPool;
+    _plans.assign(threadPool ? threadPool->size() : 1, (FABEMDPlan *)0);
+    _imageCount = 0;
+    _pixelCount = 0.0;
+    _seconds = 0.0;
+}
+
+/**
+ * @brief Release the plans of the workers.
+ */
+Batch::~Batch()
+{
+    for (unsigned int i = 0; i < _plans.size(); ++i)
+    {
+        delete _plans[i];
+    }
+}
+
+/**
+ * @brief Decompose every image of given list.
+ * The result of each image is the same as with FABEMD::execute(CImgList<float> &), and lists
+ * already in the results are reused. Throughput statistics add up over successive batches, and
+ * residueKept() then tells whether the list of an image ends with a residue.
+ * @param inputs Source images
+ * @param results Resized to one list of images per source image
+ */
+void Batch::execute(const CImgList<float> & inputs, std::vector<CImgList<float> > & results)
+{
+    const unsigned int count = inputs.size();
+    const unsigned long start = cimg::time();
+
+    results.resize(count);
+    _residuesKept.assign(count, 0);
+    ImageTask task(*this, inputs, results);
+    if (_threadPool)
+    {
+        _threadPool->run(task, count);
+    }
+    else
+    {
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            task.run(i, 0);
+        }
+    }
+
+    _seconds += (cimg::time() - start) / 1000.0;
+    _imageCount += count;
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        _pixelCount += (double)inputs[i].width() * inputs[i].height();
+    }
+}
+
+/**
+ * @brief Get the number of images decomposed per second, over every batch executed.
+ * @return Images per second, 0 if no time was measured.
+ */
+double Batch::imagesPerSecond() const
+{
+    return _seconds > 0.0 ? _imageCount / _seconds : 0.0;
+}
+
+/**
+ * @brief Get the number of millions of pixels decomposed per second, over every batch executed.
+ * @return Megapixels per second, 0 if no time was measured.
+ */
+double Batch::megapixelsPerSecond() const
+{
+    return _seconds > 0.0 ? _pixelCount / 1e6 / _seconds : 0.0;
+}
+
+/**
+ * @brief Print the aggregate throughput of every batch executed.
+ * @param stream Destination stream
+ */
+void Batch::report(std::ostream & stream) const
+{
+    stream << _imageCount << " images (" << _pixelCount / 1e6 << " Mpixels) decomposed in "
+        << _seconds << " s on " << _plans.size() << " workers: "
+        << imagesPerSecond() << " images/s, " << megapixelsPerSecond() << " Mpixels/s." << std::endl;
+}
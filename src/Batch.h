@@ -0,0 +1,48 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include <iostream>
+#include <vector>
+
+#include "CImg.h"
+#include "FABEMD.h"
+#include "FABEMDPlan.h"
+#include "ThreadPool.h"
+
+class Batch
+{
+private:
+    class ImageTask;
+
+    FABEMD::Parameters _parameters;
+    ThreadPool * _threadPool;
+    std::vector<FABEMDPlan *> _plans;
+    std::vector<unsigned char> _residuesKept;
+    unsigned int _imageCount;
+    double _pixelCount;
+    double _seconds;
+
+    Batch(const Batch &);
+    Batch & operator=(const Batch &);
+
+public:
+    Batch(const FABEMD::Parameters & parameters, ThreadPool * threadPool = 0);
+    ~Batch();
+
+    const FABEMD::Parameters & parameters() const { return this->_parameters; }
+    ThreadPool * threadPool() const { return this->_threadPool; }
+
+    void execute(const cimg_library::CImgList<float> & inputs,
+        std::vector<cimg_library::CImgList<float> > & results);
+
+    bool residueKept(unsigned int index) const { return this->_residuesKept[index] != 0; }
+
+    unsigned int imageCount() const { return this->_imageCount; }
+    double pixelCount() const { return this->_pixelCount; }
+    double seconds() const { return this->_seconds; }
+    double imagesPerSecond() const;
+    double megapixelsPerSecond() const;
+    void report(std::ostream & stream) const;
+};
+
+#endif // __BATCH_H__
@@ -0,0 +1,146 @@
+#include "DistanceTransform.h"
+
+/**
+ * @brief Create a distance transform. Buffers are allocated lazily and reused between calls.
+ */
+DistanceTransform::DistanceTransform()
+{
+}
+
+/**
+ * @brief Assign the minimal distance to another extrema for each extrema of given map.
+ * The squared distances are computed with the separable exact Euclidean distance transform of
+ * Felzenszwalb and Huttenlocher, in a time linear in the number of pixels:
+ * - The column pass gives the squared distance to the nearest extrema of the same column. On an
+ *   extrema, the extrema itself is left out so that the nearest other one is kept instead.
+ * - The row pass takes the lower envelope of the parabolas rooted at each column, and evaluates
+ *   it on the extremas only. Extremas of the same row are hidden by the column pass, so the
+ *   nearest extremas on the left and on the right of the row are checked separately.
+ * @param extremas Extrema map.
+ * @param width Width of the image the extremas were detected in
+ * @param height Height of the image the extremas were detected in
+ */
+void DistanceTransform::assignNearests(std::vector<Extrema> & extremas, unsigned int width, unsigned int height)
+{
+    // Finite sentinels, so that the transform does not depend on infinity arithmetic
+    const double unreachable = std::numeric_limits<double>::max();
+
+    // Feature map holding the index of the extrema at each pixel, plus one
+    _features.assign(width * height, 0);
+    for (unsigned int i = 0; i < extremas.size(); ++i)
+    {
+        _features[extremas[i].y() * width + extremas[i].x()] = i + 1;
+    }
+
+    // Column pass
+    _columnDistances.resize(width * height);
+    for (unsigned int x = 0; x < width; ++x)
+    {
+        int previous = -1;
+        for (unsigned int y = 0; y < height; ++y)
+        {
+            double distance = (double)y - previous;
+            _columnDistances[y * width + x] = previous >= 0 ? distance * distance : unreachable;
+            if (_features[y * width + x])
+            {
+                previous = (int)y;
+            }
+        }
+
+        int next = -1;
+        for (int y = (int)height - 1; y >= 0; --y)
+        {
+            double distance = (double)next - y;
+            double & value = _columnDistances[y * width + x];
+            if (next >= 0)
+            {
+                value = std::min(value, distance * distance);
+            }
+            if (_features[y * width + x])
+            {
+                next = y;
+            }
+        }
+    }
+
+    // Row pass
+    _parabolas.resize(width);
+    _boundaries.resize(width + 1);
+    for (unsigned int y = 0; y < height; ++y)
+    {
+        const unsigned int * features = &_features[y * width];
+        const double * f = &_columnDistances[y * width];
+        bool hasFeature = false;
+
+        // Lower envelope of the parabolas (x - q)^2 + f(q)
+        int k = -1;
+        for (unsigned int q = 0; q < width; ++q)
+        {
+            hasFeature = hasFeature || features[q];
+            if (f[q] == unreachable)
+            {
+                continue;
+            }
+
+            double s = -unreachable;
+            while (k >= 0)
+            {
+                unsigned int p = _parabolas[k];
+                s = ((f[q] + (double)q * q) - (f[p] + (double)p * p)) / (2.0 * q - 2.0 * p);
+                if (s > _boundaries[k])
+                {
+                    break;
+                }
+                --k;
+            }
+            ++k;
+            _parabolas[k] = q;
+            _boundaries[k] = k > 0 ? s : -unreachable;
+            _boundaries[k + 1] = unreachable;
+        }
+
+        if (!hasFeature)
+        {
+            continue;
+        }
+
+        // Evaluate the envelope and the row neighbours on the extremas of the row
+        int segment = 0;
+        int previous = -1;
+        for (unsigned int x = 0; x < width; ++x)
+        {
+            if (!features[x])
+            {
+                continue;
+            }
+
+            double nearest = unreachable;
+            if (k >= 0)
+            {
+                while (_boundaries[segment + 1] < x)
+                {
+                    ++segment;
+                }
+                double distance = (double)x - _parabolas[segment];
+                nearest = distance * distance + f[_parabolas[segment]];
+            }
+
+            if (previous >= 0)
+            {
+                nearest = std::min(nearest, ((double)x - previous) * ((double)x - previous));
+            }
+            for (unsigned int next = x + 1; next < width; ++next)
+            {
+                if (features[next])
+                {
+                    nearest = std::min(nearest, (double)(next - x) * (next - x));
+                    break;
+                }
+            }
+            previous = (int)x;
+
+            extremas[features[x] - 1].setDistance(nearest == unreachable ?
+                std::numeric_limits<float>::infinity() : (float)std::sqrt(nearest));
+        }
+    }
+}
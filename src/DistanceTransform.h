@@ -0,0 +1,25 @@
+#ifndef __DISTANCE_TRANSFORM_H__
+#define __DISTANCE_TRANSFORM_H__
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "Extrema.h"
+
+class DistanceTransform
+{
+private:
+    std::vector<unsigned int> _features;
+    std::vector<double> _columnDistances;
+    std::vector<unsigned int> _parabolas;
+    std::vector<double> _boundaries;
+
+public:
+    DistanceTransform();
+
+    void assignNearests(std::vector<Extrema> & extremas, unsigned int width, unsigned int height);
+};
+
+#endif // __DISTANCE_TRANSFORM_H__
@@ -1,15 +1,18 @@
 #include "Extrema.h"
 
-Extrema::Extrema(unsigned int x, unsigned int y)
+Extrema::Extrema(unsigned int x, unsigned int y, unsigned int z)
 {
     _x = x;
     _y = y;
+    _z = z;
     _distance = std::numeric_limits<float>::infinity();
 }
 
 float Extrema::distanceTo(const Extrema &extrema) const
 {
-    unsigned int dx = this->x() - extrema.x();
-    unsigned int dy = this->y() - extrema.y();
-    return (float) sqrt(dx * dx + dy * dy);
+    // Squared in double, which holds them exactly, as 32 bits wrap from 65536 pixels away
+    double dx = (double)this->_x - extrema._x;
+    double dy = (double)this->_y - extrema._y;
+    double dz = (double)this->_z - extrema._z;
+    return (float) sqrt(dx * dx + dy * dy + dz * dz);
 }
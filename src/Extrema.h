@@ -27,17 +27,20 @@ public:
 private:
     int _x;
     int _y;
+    int _z;
     float _distance;
 
 public:
-    Extrema(unsigned int x = 0, unsigned int y = 0);
+    Extrema(unsigned int x = 0, unsigned int y = 0, unsigned int z = 0);
 
     unsigned int x() const { return this->_x; }
     unsigned int y() const { return this->_y; }
+    unsigned int z() const { return this->_z; }
     float distance() const { return this->_distance; }
 
     void setX(unsigned int x) { this->_x = x; }
     void setY(unsigned int y) { this->_y = y; }
+    void setZ(unsigned int z) { this->_z = z; }
     void setDistance(float distance) { this->_distance = distance; }
 
     float distanceTo(const Extrema & extrema) const;
@@ -0,0 +1,854 @@
+#include "ExtremaDetector.h"
+
+using namespace cimg_library;
+
+namespace
+{
+    /**
+     * @brief Get the index of the lowest set bit of a non zero mask.
+     */
+    inline unsigned int lowestBit(unsigned int mask)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return (unsigned int)index;
+#else
+        return (unsigned int)__builtin_ctz(mask);
+#endif
+    }
+
+    /**
+     * @brief Get the number of set bits of a mask.
+     */
+    inline unsigned int bitCount(unsigned int mask)
+    {
+#ifdef _MSC_VER
+        return (unsigned int)__popcnt(mask);
+#else
+        return (unsigned int)__builtin_popcount(mask);
+#endif
+    }
+
+    /**
+     * @brief Scan output appending the extremas to the minima and maxima maps.
+     * Masks hold one bit per pixel of a row, starting at column m of row n of slice z.
+     */
+    class ExtremaMaps
+    {
+    private:
+        std::vector<Extrema> & _minimas;
+        std::vector<Extrema> & _maximas;
+
+    public:
+        ExtremaMaps(std::vector<Extrema> & minimas, std::vector<Extrema> & maximas)
+            : _minimas(minimas), _maximas(maximas)
+        {
+        }
+
+        void add(unsigned int m, unsigned int n, unsigned int z, unsigned int minimaMask, unsigned int maximaMask)
+        {
+            while (maximaMask)
+            {
+                _maximas.push_back(Extrema(m + lowestBit(maximaMask), n, z));
+                maximaMask &= maximaMask - 1;
+            }
+            while (minimaMask)
+            {
+                _minimas.push_back(Extrema(m + lowestBit(minimaMask), n, z));
+                minimaMask &= minimaMask - 1;
+            }
+        }
+    };
+
+    /**
+     * @brief Scan output only counting the extremas.
+     */
+    class ExtremaCounter
+    {
+    private:
+        unsigned int _count;
+
+    public:
+        ExtremaCounter() : _count(0)
+        {
+        }
+
+        unsigned int count() const { return _count; }
+
+        void add(unsigned int, unsigned int, unsigned int, unsigned int minimaMask, unsigned int maximaMask)
+        {
+            _count += bitCount(minimaMask) + bitCount(maximaMask);
+        }
+    };
+
+    /**
+     * @brief Scan output of an image with interleaved channels, appending the extremas to the maps
+     * of their channel. Masks hold one bit per element of a row, starting at element k of row n.
+     */
+    class InterleavedMaps
+    {
+    private:
+        std::vector<std::vector<Extrema> > & _minimas;
+        std::vector<std::vector<Extrema> > & _maximas;
+        unsigned int _channels;
+
+    public:
+        InterleavedMaps(std::vector<std::vector<Extrema> > & minimas, std::vector<std::vector<Extrema> > & maximas,
+            unsigned int channels)
+            : _minimas(minimas), _maximas(maximas), _channels(channels)
+        {
+        }
+
+        void add(unsigned int k, unsigned int n, unsigned int minimaMask, unsigned int maximaMask)
+        {
+            while (maximaMask)
+            {
+                unsigned int element = k + lowestBit(maximaMask);
+                _maximas[element % _channels].push_back(Extrema(element / _channels, n));
+                maximaMask &= maximaMask - 1;
+            }
+            while (minimaMask)
+            {
+                unsigned int element = k + lowestBit(minimaMask);
+                _minimas[element % _channels].push_back(Extrema(element / _channels, n));
+                minimaMask &= minimaMask - 1;
+            }
+        }
+    };
+
+    /**
+     * @brief Scan output of an image with interleaved channels, appending the extremas of every channel
+     * to the maps of a band. The channel of each extrema is kept as its z coordinate until the bands
+     * are merged into the maps of each channel.
+     */
+    class InterleavedBandMaps
+    {
+    private:
+        std::vector<Extrema> & _minimas;
+        std::vector<Extrema> & _maximas;
+        unsigned int _channels;
+
+    public:
+        InterleavedBandMaps(std::vector<Extrema> & minimas, std::vector<Extrema> & maximas, unsigned int channels)
+            : _minimas(minimas), _maximas(maximas), _channels(channels)
+        {
+        }
+
+        void add(unsigned int k, unsigned int n, unsigned int minimaMask, unsigned int maximaMask)
+        {
+            while (maximaMask)
+            {
+                unsigned int element = k + lowestBit(maximaMask);
+                _maximas.push_back(Extrema(element / _channels, n, element % _channels));
+                maximaMask &= maximaMask - 1;
+            }
+            while (minimaMask)
+            {
+                unsigned int element = k + lowestBit(minimaMask);
+                _minimas.push_back(Extrema(element / _channels, n, element % _channels));
+                minimaMask &= minimaMask - 1;
+            }
+        }
+    };
+
+    /**
+     * @brief Scan output of an image with interleaved channels, only counting the extremas of each channel.
+     */
+    class InterleavedCounter
+    {
+    private:
+        unsigned int * _counts;
+        unsigned int _channels;
+
+    public:
+        InterleavedCounter(unsigned int * counts, unsigned int channels)
+            : _counts(counts), _channels(channels)
+        {
+        }
+
+        void add(unsigned int k, unsigned int, unsigned int minimaMask, unsigned int maximaMask)
+        {
+            while (maximaMask)
+            {
+                ++_counts[(k + lowestBit(maximaMask)) % _channels];
+                maximaMask &= maximaMask - 1;
+            }
+            while (minimaMask)
+            {
+                ++_counts[(k + lowestBit(minimaMask)) % _channels];
+                minimaMask &= minimaMask - 1;
+            }
+        }
+    };
+
+    /**
+     * @brief Compare one pixel to its 8 neighbours.
+     * A neighbour that is not comparable (NaN) does not prevent the pixel from being an extrema,
+     * as in the generic detection.
+     * @param center Pointer to the pixel, in a row with valid neighbours on both sides
+     * @param width Row stride of the image
+     * @param step Distance between two horizontal neighbours, the channel count of an interleaved image
+     * @param minimaMask Set to 1 if the pixel is strictly lower than all of its neighbours
+     * @return 1 if the pixel is strictly higher than all of its neighbours.
+     */
+    inline unsigned int strictExtremaScalar(const float * center, unsigned int width, unsigned int step,
+        unsigned int & minimaMask)
+    {
+        const float c = *center;
+        const float * up = center - width;
+        const float * down = center + width;
+        const int left = -(int)step;
+        unsigned int maxima = !(up[left] >= c) & !(up[0] >= c) & !(up[step] >= c)
+            & !(center[left] >= c) & !(center[step] >= c)
+            & !(down[left] >= c) & !(down[0] >= c) & !(down[step] >= c);
+        minimaMask = !(up[left] <= c) & !(up[0] <= c) & !(up[step] <= c)
+            & !(center[left] <= c) & !(center[step] <= c)
+            & !(down[left] <= c) & !(down[0] <= c) & !(down[step] <= c);
+        return maxima;
+    }
+
+    /**
+     * @brief Compare one voxel to its 18 neighbours in the previous and next slices.
+     * @param center Pointer to the voxel, in a row and slice with valid neighbours on all sides
+     * @param width Row stride of the volume
+     * @param plane Slice stride of the volume
+     * @param minima Cleared if the voxel is not strictly lower than all of these neighbours
+     * @param maxima Cleared if the voxel is not strictly higher than all of these neighbours
+     */
+    inline void strictExtremaAcrossSlices(const float * center, unsigned int width, unsigned int plane,
+        unsigned int & minima, unsigned int & maxima)
+    {
+        const float c = *center;
+        const float * slices[2] = { center - plane, center + plane };
+
+        for (unsigned int i = 0; i < 2; ++i)
+        {
+            const float * rows[3] = { slices[i] - width, slices[i], slices[i] + width };
+            for (unsigned int j = 0; j < 3; ++j)
+            {
+                const float * row = rows[j];
+                maxima &= !(row[-1] >= c) & !(row[0] >= c) & !(row[1] >= c);
+                minima &= !(row[-1] <= c) & !(row[0] <= c) & !(row[1] <= c);
+            }
+        }
+    }
+
+#if defined(__AVX512F__)
+    const unsigned int LANES = 16;
+
+    inline unsigned int strictExtremaVector(const float * center, unsigned int width, unsigned int step,
+        unsigned int & minimaMask)
+    {
+        const float * up = center - width;
+        const float * down = center + width;
+        const __m512 c = _mm512_loadu_ps(center);
+        __m512 neighbours[8] = {
+            _mm512_loadu_ps(up - step), _mm512_loadu_ps(up), _mm512_loadu_ps(up + step),
+            _mm512_loadu_ps(center - step), _mm512_loadu_ps(center + step),
+            _mm512_loadu_ps(down - step), _mm512_loadu_ps(down), _mm512_loadu_ps(down + step) };
+        __mmask16 maxima = 0xFFFF;
+        __mmask16 minima = 0xFFFF;
+        for (unsigned int i = 0; i < 8; ++i)
+        {
+            maxima = _mm512_mask_cmp_ps_mask(maxima, neighbours[i], c, _CMP_NGE_UQ);
+            minima = _mm512_mask_cmp_ps_mask(minima, neighbours[i], c, _CMP_NLE_UQ);
+        }
+        minimaMask = minima;
+        return maxima;
+    }
+#elif defined(__AVX__)
+    const unsigned int LANES = 8;
+
+    inline unsigned int strictExtremaVector(const float * center, unsigned int width, unsigned int step,
+        unsigned int & minimaMask)
+    {
+        const float * up = center - width;
+        const float * down = center + width;
+        const __m256 c = _mm256_loadu_ps(center);
+        __m256 neighbours[8] = {
+            _mm256_loadu_ps(up - step), _mm256_loadu_ps(up), _mm256_loadu_ps(up + step),
+            _mm256_loadu_ps(center - step), _mm256_loadu_ps(center + step),
+            _mm256_loadu_ps(down - step), _mm256_loadu_ps(down), _mm256_loadu_ps(down + step) };
+        __m256 maxima = _mm256_cmp_ps(neighbours[0], c, _CMP_NGE_UQ);
+        __m256 minima = _mm256_cmp_ps(neighbours[0], c, _CMP_NLE_UQ);
+        for (unsigned int i = 1; i < 8; ++i)
+        {
+            maxima = _mm256_and_ps(maxima, _mm256_cmp_ps(neighbours[i], c, _CMP_NGE_UQ));
+            minima = _mm256_and_ps(minima, _mm256_cmp_ps(neighbours[i], c, _CMP_NLE_UQ));
+        }
+        minimaMask = (unsigned int)_mm256_movemask_ps(minima);
+        return (unsigned int)_mm256_movemask_ps(maxima);
+    }
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    const unsigned int LANES = 4;
+
+    inline unsigned int strictExtremaVector(const float * center, unsigned int width, unsigned int step,
+        unsigned int & minimaMask)
+    {
+        const float * up = center - width;
+        const float * down = center + width;
+        const __m128 c = _mm_loadu_ps(center);
+        __m128 neighbours[8] = {
+            _mm_loadu_ps(up - step), _mm_loadu_ps(up), _mm_loadu_ps(up + step),
+            _mm_loadu_ps(center - step), _mm_loadu_ps(center + step),
+            _mm_loadu_ps(down - step), _mm_loadu_ps(down), _mm_loadu_ps(down + step) };
+        __m128 maxima = _mm_cmpnge_ps(neighbours[0], c);
+        __m128 minima = _mm_cmpnle_ps(neighbours[0], c);
+        for (unsigned int i = 1; i < 8; ++i)
+        {
+            maxima = _mm_and_ps(maxima, _mm_cmpnge_ps(neighbours[i], c));
+            minima = _mm_and_ps(minima, _mm_cmpnle_ps(neighbours[i], c));
+        }
+        minimaMask = (unsigned int)_mm_movemask_ps(minima);
+        return (unsigned int)_mm_movemask_ps(maxima);
+    }
+#else
+    const unsigned int LANES = 1;
+
+    inline unsigned int strictExtremaVector(const float * center, unsigned int width, unsigned int step,
+        unsigned int & minimaMask)
+    {
+        return strictExtremaScalar(center, width, step, minimaMask);
+    }
+#endif
+}
+
+/**
+ * @brief Detection of the extremas of a band of rows, run by the thread pool.
+ */
+class ExtremaDetector::BandTask : public ThreadPool::Task
+{
+private:
+    ExtremaDetector & _detector;
+    const CImg<float> & _image;
+    unsigned int _bandCount;
+
+public:
+    BandTask(ExtremaDetector & detector, const CImg<float> & image, unsigned int bandCount)
+        : _detector(detector), _image(image), _bandCount(bandCount)
+    {
+    }
+
+    void run(unsigned int index, unsigned int)
+    {
+        unsigned int rows = (unsigned int)(_image.height() * _image.depth());
+        _detector._bandMinimas[index].clear();
+        _detector._bandMaximas[index].clear();
+        _detector.detectRows(_image, index * rows / _bandCount, (index + 1) * rows / _bandCount,
+            _detector._bandMinimas[index], _detector._bandMaximas[index]);
+    }
+};
+
+/**
+ * @brief Detection or counting of the extremas of every channel of a band of rows of an image with
+ * interleaved channels, run by the thread pool.
+ */
+class ExtremaDetector::InterleavedBandTask : public ThreadPool::Task
+{
+private:
+    ExtremaDetector & _detector;
+    const CImg<float> & _image;
+    unsigned int _bandCount;
+    unsigned int _limit;
+
+public:
+    InterleavedBandTask(ExtremaDetector & detector, const CImg<float> & image, unsigned int bandCount,
+        unsigned int limit)
+        : _detector(detector), _image(image), _bandCount(bandCount), _limit(limit)
+    {
+    }
+
+    void run(unsigned int index, unsigned int)
+    {
+        const unsigned int channels = (unsigned int)_image.width();
+        const unsigned int rows = (unsigned int)_image.depth();
+        const unsigned int firstRow = index * rows / _bandCount;
+        const unsigned int lastRow = (index + 1) * rows / _bandCount;
+
+        if (_limit == 0)
+        {
+            InterleavedBandMaps output(_detector._bandMinimas[index], _detector._bandMaximas[index], channels);
+            _detector._bandMinimas[index].clear();
+            _detector._bandMaximas[index].clear();
+            for (unsigned int n = firstRow; n < lastRow; ++n)
+            {
+                _detector.scanInterleavedRow(_image, n, output);
+            }
+            return;
+        }
+
+        unsigned int * counts = &_detector._bandCounts[index * channels];
+        InterleavedCounter output(counts, channels);
+        std::fill(counts, counts + channels, 0);
+        for (unsigned int n = firstRow; n < lastRow && *std::min_element(counts, counts + channels) < _limit; ++n)
+        {
+            _detector.scanInterleavedRow(_image, n, output);
+        }
+    }
+};
+
+/**
+ * @brief Create an extrema detector.
+ * @param size Size of the extrema search window
+ */
+ExtremaDetector::ExtremaDetector(unsigned int size)
+{
+    _size = size;
+    _threadPool = 0;
+}
+
+/**
+ * @brief Check whether a pixel is a local extrema over a window of any size.
+ * The window is clamped to the image borders. In a volume, the window is a cube.
+ * @param image Source image
+ * @param m Column of the pixel
+ * @param n Row of the pixel
+ * @param z Slice of the pixel
+ * @param output Scan output, given the pixel if strictly lower (higher) than each of its neighbours
+ */
+template<typename Output>
+void ExtremaDetector::scanPixel(const CImg<float> & image, unsigned int m, unsigned int n, unsigned int z,
+    Output & output) const
+{
+    bool isMaxima = true;
+    bool isMinima = true;
+    unsigned int minK = (unsigned int)std::max(0, (int)(m - (_size - 1) / 2));
+    unsigned int minL = (unsigned int)std::max(0, (int)(n - (_size - 1) / 2));
+    unsigned int minP = (unsigned int)std::max(0, (int)(z - (_size - 1) / 2));
+    unsigned int maxK = (unsigned int)std::min((int)(image.width() - 1), (int)(m + (_size - 1) / 2));
+    unsigned int maxL = (unsigned int)std::min((int)(image.height() - 1), (int)(n + (_size - 1) / 2));
+    unsigned int maxP = (unsigned int)std::min((int)(image.depth() - 1), (int)(z + (_size - 1) / 2));
+    const float value = image(m, n, z);
+
+    // Loop over (m,n,z) neighborhood
+    for (unsigned int p = minP; (isMinima || isMaxima) && p <= maxP; ++p)
+    {
+        unsigned int k = minK;
+        unsigned int l = minL;
+        while ((isMinima || isMaxima) && k <= maxK)
+        {
+            while ((isMinima || isMaxima) && l <= maxL)
+            {
+                if (k != m || l != n || p != z)
+                {
+                    if (image(k, l, p) >= value)
+                    {
+                        isMaxima = false;
+                    }
+                    if (image(k, l, p) <= value)
+                    {
+                        isMinima = false;
+                    }
+
+                }
+                ++l;
+            }
+            l = minL;
+            ++k;
+        }
+    }
+
+    // Add point to local maxima (minima) map if strictly higher (lower) than each of its neighbour
+    output.add(m, n, z, isMinima ? 1 : 0, isMaxima ? 1 : 0);
+}
+
+/**
+ * @brief Detect the local extremas of an inner row of the image over a 3x3 window.
+ * Pixels are compared to their 8 neighbours a vector at a time, and the resulting bitmasks of
+ * strict maximas and minimas are handed to the output. The first and last pixels of the row have
+ * a clamped window and go through the generic detection.
+ * @param image Source image, at least 3 pixels wide and high
+ * @param n Row, neither the first nor the last one
+ * @param output Scan output
+ */
+template<typename Output>
+void ExtremaDetector::scanRow3x3(const CImg<float> & image, unsigned int n, Output & output) const
+{
+    const unsigned int width = (unsigned int)image.width();
+    const float * row = image.data(0, n);
+    unsigned int m = 1;
+
+    scanPixel(image, 0, n, 0, output);
+
+    for (; m + LANES <= width - 1; m += LANES)
+    {
+        unsigned int minimaMask;
+        unsigned int maximaMask = strictExtremaVector(row + m, width, 1, minimaMask);
+        output.add(m, n, 0, minimaMask, maximaMask);
+    }
+
+    for (; m < width - 1; ++m)
+    {
+        unsigned int minimaMask;
+        unsigned int maximaMask = strictExtremaScalar(row + m, width, 1, minimaMask);
+        output.add(m, n, 0, minimaMask, maximaMask);
+    }
+
+    scanPixel(image, width - 1, n, 0, output);
+}
+
+/**
+ * @brief Detect the local extremas of an inner row of a volume over a 3x3x3 window.
+ * Voxels are first compared to their 8 neighbours of the same slice a vector at a time. The few
+ * candidates left are then compared to their 18 neighbours of the previous and next slices.
+ * The first and last voxels of the row have a clamped window and go through the generic detection.
+ * @param image Source volume, at least 3 voxels wide, high and deep
+ * @param n Row, neither the first nor the last one
+ * @param z Slice, neither the first nor the last one
+ * @param output Scan output
+ */
+template<typename Output>
+void ExtremaDetector::scanRow3x3x3(const CImg<float> & image, unsigned int n, unsigned int z, Output & output) const
+{
+    const unsigned int width = (unsigned int)image.width();
+    const unsigned int plane = width * (unsigned int)image.height();
+    const float * row = image.data(0, n, z);
+    unsigned int m = 1;
+
+    scanPixel(image, 0, n, z, output);
+
+    for (; m + LANES <= width - 1; m += LANES)
+    {
+        unsigned int minimaMask;
+        unsigned int maximaMask = strictExtremaVector(row + m, width, 1, minimaMask);
+        unsigned int candidates = minimaMask | maximaMask;
+        while (candidates)
+        {
+            unsigned int bit = lowestBit(candidates);
+            unsigned int minima = (minimaMask >> bit) & 1;
+            unsigned int maxima = (maximaMask >> bit) & 1;
+            strictExtremaAcrossSlices(row + m + bit, width, plane, minima, maxima);
+            minimaMask &= ~((minima ^ 1) << bit);
+            maximaMask &= ~((maxima ^ 1) << bit);
+            candidates &= candidates - 1;
+        }
+        output.add(m, n, z, minimaMask, maximaMask);
+    }
+
+    for (; m < width - 1; ++m)
+    {
+        unsigned int minimaMask;
+        unsigned int maximaMask = strictExtremaScalar(row + m, width, 1, minimaMask);
+        if (minimaMask | maximaMask)
+        {
+            strictExtremaAcrossSlices(row + m, width, plane, minimaMask, maximaMask);
+        }
+        output.add(m, n, z, minimaMask, maximaMask);
+    }
+
+    scanPixel(image, width - 1, n, z, output);
+}
+
+/**
+ * @brief Detect the local extremas of a row, in increasing column order.
+ * @param image Source image
+ * @param n Row
+ * @param z Slice, 0 for a 2D image
+ * @param output Scan output
+ */
+template<typename Output>
+void ExtremaDetector::scanRow(const CImg<float> & image, unsigned int n, unsigned int z, Output & output) const
+{
+    const unsigned int width = (unsigned int)image.width();
+    const unsigned int height = (unsigned int)image.height();
+    const unsigned int depth = (unsigned int)image.depth();
+
+    if (_size == 3 && width >= 3 && n > 0 && n < height - 1 && depth == 1)
+    {
+        scanRow3x3(image, n, output);
+    }
+    else if (_size == 3 && width >= 3 && n > 0 && n < height - 1 && z > 0 && z + 1 < depth)
+    {
+        scanRow3x3x3(image, n, z, output);
+    }
+    else
+    {
+        for (unsigned int m = 0; m < width; ++m)
+        {
+            scanPixel(image, m, n, z, output);
+        }
+    }
+}
+
+/**
+ * @brief Check whether an element of an image with interleaved channels is a local extrema of its
+ * channel over a window of any size, clamped to the image borders.
+ * @param image Source image, whose width() channels are interleaved, of height() columns and depth() rows
+ * @param k Element of the row, the pixel being k / channels and the channel k % channels
+ * @param n Row of the pixel
+ * @param output Scan output, given the element if strictly lower (higher) than each of its neighbours
+ */
+template<typename Output>
+void ExtremaDetector::scanInterleavedElement(const CImg<float> & image, unsigned int k, unsigned int n,
+    Output & output) const
+{
+    const unsigned int channels = (unsigned int)image.width();
+    const unsigned int c = k % channels;
+    const unsigned int m = k / channels;
+    const unsigned int halfSize = (_size - 1) / 2;
+    const unsigned int minK = m - std::min(halfSize, m);
+    const unsigned int minL = n - std::min(halfSize, n);
+    const unsigned int maxK = std::min((unsigned int)image.height() - 1, m + halfSize);
+    const unsigned int maxL = std::min((unsigned int)image.depth() - 1, n + halfSize);
+    const float value = image(c, m, n);
+    bool isMaxima = true;
+    bool isMinima = true;
+
+    for (unsigned int l = minL; (isMinima || isMaxima) && l <= maxL; ++l)
+    {
+        for (unsigned int j = minK; (isMinima || isMaxima) && j <= maxK; ++j)
+        {
+            if (j != m || l != n)
+            {
+                if (image(c, j, l) >= value)
+                {
+                    isMaxima = false;
+                }
+                if (image(c, j, l) <= value)
+                {
+                    isMinima = false;
+                }
+            }
+        }
+    }
+
+    output.add(k, n, isMinima ? 1 : 0, isMaxima ? 1 : 0);
+}
+
+/**
+ * @brief Detect the local extremas of every channel of a row of an image with interleaved channels.
+ * Over a 3x3 window, the elements of inner pixels are compared to the same channel of their 8
+ * neighbours a vector at a time, a vector covering every channel of a few consecutive pixels.
+ * @param image Source image, whose width() channels are interleaved, of height() columns and depth() rows
+ * @param n Row
+ * @param output Scan output
+ */
+template<typename Output>
+void ExtremaDetector::scanInterleavedRow(const CImg<float> & image, unsigned int n, Output & output) const
+{
+    const unsigned int channels = (unsigned int)image.width();
+    const unsigned int width = (unsigned int)image.height();
+    const unsigned int height = (unsigned int)image.depth();
+    const unsigned int rowLength = channels * width;
+
+    if (_size != 3 || width < 3 || n == 0 || n + 1 >= height)
+    {
+        for (unsigned int k = 0; k < rowLength; ++k)
+        {
+            scanInterleavedElement(image, k, n, output);
+        }
+        return;
+    }
+
+    const float * row = image.data(0, 0, n);
+    unsigned int k = 0;
+
+    for (; k < channels; ++k)
+    {
+        scanInterleavedElement(image, k, n, output);
+    }
+
+    for (; k + LANES <= rowLength - channels; k += LANES)
+    {
+        unsigned int minimaMask;
+        unsigned int maximaMask = strictExtremaVector(row + k, rowLength, channels, minimaMask);
+        output.add(k, n, minimaMask, maximaMask);
+    }
+
+    for (; k < rowLength - channels; ++k)
+    {
+        unsigned int minimaMask;
+        unsigned int maximaMask = strictExtremaScalar(row + k, rowLength, channels, minimaMask);
+        output.add(k, n, minimaMask, maximaMask);
+    }
+
+    for (; k < rowLength; ++k)
+    {
+        scanInterleavedElement(image, k, n, output);
+    }
+}
+
+/**
+ * @brief Append the local extremas of a band of rows to the maps, in row-major order.
+ * The rows of a volume are numbered slice after slice, so that a band of a volume is a slab.
+ * @param image Source image
+ * @param firstRow First row of the band
+ * @param lastRow Row following the last row of the band
+ * @param minimas Local minima map
+ * @param maximas Local maxima map
+ */
+void ExtremaDetector::detectRows(const CImg<float> & image, unsigned int firstRow, unsigned int lastRow,
+    std::vector<Extrema> & minimas, std::vector<Extrema> & maximas) const
+{
+    const unsigned int height = (unsigned int)image.height();
+    ExtremaMaps output(minimas, maximas);
+
+    for (unsigned int row = firstRow; row < lastRow; ++row)
+    {
+        scanRow(image, row % height, row / height, output);
+    }
+}
+
+/**
+ * @brief Build the maps of minimas and maximas of given image.
+ * Both maps are cleared first, and filled in row-major order. With a thread pool, the rows are
+ * split into bands detected concurrently into their own buffers, then merged in row order, so
+ * that the maps are the same as with a serial detection.
+ * @param image Source image
+ * @param minimas Local minima map
+ * @param maximas Local maxima map
+ */
+void ExtremaDetector::detect(const CImg<float> & image,
+    std::vector<Extrema> & minimas, std::vector<Extrema> & maximas)
+{
+    const unsigned int rows = (unsigned int)(image.height() * image.depth());
+
+    minimas.clear();
+    maximas.clear();
+
+    if (!_threadPool || _threadPool->size() == 1 || rows < 2)
+    {
+        detectRows(image, 0, rows, minimas, maximas);
+        return;
+    }
+
+    // A few bands per worker balance the load between rows with many and few extremas
+    unsigned int bandCount = std::min(rows, 4 * _threadPool->size());
+    if (_bandMinimas.size() < bandCount)
+    {
+        _bandMinimas.resize(bandCount);
+        _bandMaximas.resize(bandCount);
+    }
+
+    BandTask task(*this, image, bandCount);
+    _threadPool->run(task, bandCount);
+
+    for (unsigned int band = 0; band < bandCount; ++band)
+    {
+        minimas.insert(minimas.end(), _bandMinimas[band].begin(), _bandMinimas[band].end());
+        maximas.insert(maximas.end(), _bandMaximas[band].begin(), _bandMaximas[band].end());
+    }
+}
+
+/**
+ * @brief Count the local minimas and maximas of given image, without building their maps.
+ * @param image Source image
+ * @param limit Count from which the scan stops early
+ * @return Number of extremas, or a number not lower than limit if the scan stopped early.
+ */
+unsigned int ExtremaDetector::count(const CImg<float> & image, unsigned int limit) const
+{
+    const unsigned int height = (unsigned int)image.height();
+    const unsigned int rows = height * (unsigned int)image.depth();
+    ExtremaCounter output;
+
+    for (unsigned int row = 0; row < rows && output.count() < limit; ++row)
+    {
+        scanRow(image, row % height, row / height, output);
+    }
+
+    return output.count();
+}
+
+/**
+ * @brief Build the maps of minimas and maximas of each channel of an image with interleaved channels,
+ * as given by CImg::get_permute_axes("cxyz") of a 2D image. The maps of each channel are the same
+ * as those detect() builds from this channel alone. With a thread pool, the rows are split into
+ * bands detected concurrently, then merged in row order into the maps of each channel.
+ * @param image Source image, whose width() channels are interleaved, of height() columns and depth() rows
+ * @param minimas Resized to one local minima map per channel
+ * @param maximas Resized to one local maxima map per channel
+ */
+void ExtremaDetector::detectInterleaved(const CImg<float> & image,
+    std::vector<std::vector<Extrema> > & minimas, std::vector<std::vector<Extrema> > & maximas)
+{
+    const unsigned int channels = (unsigned int)image.width();
+    const unsigned int rows = (unsigned int)image.depth();
+
+    minimas.resize(channels);
+    maximas.resize(channels);
+    for (unsigned int c = 0; c < channels; ++c)
+    {
+        minimas[c].clear();
+        maximas[c].clear();
+    }
+
+    if (!_threadPool || _threadPool->size() == 1 || rows < 2)
+    {
+        InterleavedMaps output(minimas, maximas, channels);
+        for (unsigned int n = 0; n < rows; ++n)
+        {
+            scanInterleavedRow(image, n, output);
+        }
+        return;
+    }
+
+    unsigned int bandCount = std::min(rows, 4 * _threadPool->size());
+    if (_bandMinimas.size() < bandCount)
+    {
+        _bandMinimas.resize(bandCount);
+        _bandMaximas.resize(bandCount);
+    }
+
+    InterleavedBandTask task(*this, image, bandCount, 0);
+    _threadPool->run(task, bandCount);
+
+    for (unsigned int band = 0; band < bandCount; ++band)
+    {
+        for (std::vector<Extrema>::const_iterator i = _bandMinimas[band].begin(); i != _bandMinimas[band].end(); ++i)
+        {
+            minimas[i->z()].push_back(Extrema(i->x(), i->y()));
+        }
+        for (std::vector<Extrema>::const_iterator i = _bandMaximas[band].begin(); i != _bandMaximas[band].end(); ++i)
+        {
+            maximas[i->z()].push_back(Extrema(i->x(), i->y()));
+        }
+    }
+}
+
+/**
+ * @brief Count the minimas and maximas of each channel of an image with interleaved channels.
+ * With a thread pool, the bands of rows are counted concurrently, each one stopping early on its own.
+ * @param image Source image, whose width() channels are interleaved, of height() columns and depth() rows
+ * @param limit Count from which counting stops early, once reached by every channel
+ * @param counts Resized to the extrema count of each channel
+ */
+void ExtremaDetector::countInterleaved(const CImg<float> & image, unsigned int limit,
+    std::vector<unsigned int> & counts)
+{
+    const unsigned int channels = (unsigned int)image.width();
+    const unsigned int rows = (unsigned int)image.depth();
+
+    counts.assign(channels, 0);
+    if (!_threadPool || _threadPool->size() == 1 || rows < 2 || limit == 0)
+    {
+        InterleavedCounter output(&counts[0], channels);
+        for (unsigned int n = 0; n < rows; ++n)
+        {
+            if (*std::min_element(counts.begin(), counts.end()) >= limit)
+            {
+                break;
+            }
+            scanInterleavedRow(image, n, output);
+        }
+        return;
+    }
+
+    unsigned int bandCount = std::min(rows, 4 * _threadPool->size());
+    if (_bandCounts.size() < bandCount * channels)
+    {
+        _bandCounts.resize(bandCount * channels);
+    }
+
+    InterleavedBandTask task(*this, image, bandCount, limit);
+    _threadPool->run(task, bandCount);
+
+    for (unsigned int band = 0; band < bandCount; ++band)
+    {
+        for (unsigned int c = 0; c < channels; ++c)
+        {
+            counts[c] += _bandCounts[band * channels + c];
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef __EXTREMA_DETECTOR_H__
+#define __EXTREMA_DETECTOR_H__
+
+#include <algorithm>
+#include <vector>
+
+#if defined(__AVX512F__) || defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "CImg.h"
+#include "Extrema.h"
+#include "ThreadPool.h"
+
+class ExtremaDetector
+{
+private:
+    class BandTask;
+    class InterleavedBandTask;
+
+    unsigned int _size;
+    ThreadPool * _threadPool;
+    std::vector<std::vector<Extrema> > _bandMinimas;
+    std::vector<std::vector<Extrema> > _bandMaximas;
+    std::vector<unsigned int> _bandCounts;
+
+    template<typename Output>
+    void scanPixel(const cimg_library::CImg<float> & image, unsigned int m, unsigned int n, unsigned int z,
+        Output & output) const;
+    template<typename Output>
+    void scanRow3x3(const cimg_library::CImg<float> & image, unsigned int n, Output & output) const;
+    template<typename Output>
+    void scanRow3x3x3(const cimg_library::CImg<float> & image, unsigned int n, unsigned int z, Output & output) const;
+    template<typename Output>
+    void scanRow(const cimg_library::CImg<float> & image, unsigned int n, unsigned int z, Output & output) const;
+    template<typename Output>
+    void scanInterleavedElement(const cimg_library::CImg<float> & image, unsigned int k, unsigned int n,
+        Output & output) const;
+    template<typename Output>
+    void scanInterleavedRow(const cimg_library::CImg<float> & image, unsigned int n, Output & output) const;
+
+public:
+    ExtremaDetector(unsigned int size = 3);
+
+    unsigned int size() const { return this->_size; }
+    void setSize(unsigned int size) { this->_size = size; }
+    ThreadPool * threadPool() const { return this->_threadPool; }
+    void setThreadPool(ThreadPool * threadPool) { this->_threadPool = threadPool; }
+
+    void detectRows(const cimg_library::CImg<float> & image, unsigned int firstRow, unsigned int lastRow,
+        std::vector<Extrema> & minimas, std::vector<Extrema> & maximas) const;
+    void detect(const cimg_library::CImg<float> & image,
+        std::vector<Extrema> & minimas, std::vector<Extrema> & maximas);
+    unsigned int count(const cimg_library::CImg<float> & image, unsigned int limit) const;
+    void detectInterleaved(const cimg_library::CImg<float> & image,
+        std::vector<std::vector<Extrema> > & minimas, std::vector<std::vector<Extrema> > & maximas);
+    void countInterleaved(const cimg_library::CImg<float> & image, unsigned int limit,
+        std::vector<unsigned int> & counts);
+};
+
+#endif // __EXTREMA_DETECTOR_H__
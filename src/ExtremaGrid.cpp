@@ -0,0 +1,209 @@
+#include "ExtremaGrid.h"
+
+/**
+ * @brief Create an empty grid. Buckets are allocated by build() and reused between builds.
+ */
+ExtremaGrid::ExtremaGrid()
+{
+    _extremas = 0;
+    _cellSize = 1;
+    _columns = 0;
+    _rows = 0;
+    _layers = 0;
+}
+
+/**
+ * @brief Get the index of the cell containing given extrema.
+ * @param extrema Extrema
+ * @return Cell index, in row-major order, layer after layer.
+ */
+unsigned int ExtremaGrid::cellIndex(const Extrema & extrema) const
+{
+    return ((extrema.z() / _cellSize) * _rows + extrema.y() / _cellSize) * _columns + extrema.x() / _cellSize;
+}
+
+/**
+ * @brief Bucket given extremas in a uniform grid.
+ * The cell size is chosen so that each cell holds about one extrema on average. The cells of a
+ * volume are cubes.
+ * The extremas must outlive the grid, or at least the following queries.
+ * @param extremas Extrema map
+ * @param width Width of the image the extremas were detected in
+ * @param height Height of the image the extremas were detected in
+ * @param depth Depth of the image the extremas were detected in, 1 for a 2D image
+ */
+void ExtremaGrid::build(const std::vector<Extrema> & extremas, unsigned int width, unsigned int height,
+    unsigned int depth)
+{
+    double area = (double)width * height * depth / std::max((size_t)1, extremas.size());
+    _extremas = &extremas;
+    _cellSize = std::max(1U, (unsigned int)std::ceil(depth > 1 ? std::pow(area, 1.0 / 3.0) : std::sqrt(area)));
+    _columns = (width + _cellSize - 1) / _cellSize;
+    _rows = (height + _cellSize - 1) / _cellSize;
+    _layers = (depth + _cellSize - 1) / _cellSize;
+
+    const unsigned int cellCount = _columns * _rows * _layers;
+
+    // Counting sort of the extremas by cell
+    _cellStarts.assign(cellCount + 1, 0);
+    for (std::vector<Extrema>::const_iterator i = extremas.begin(); i != extremas.end(); ++i)
+    {
+        ++_cellStarts[cellIndex(*i) + 1];
+    }
+    for (unsigned int cell = 0; cell < cellCount; ++cell)
+    {
+        _cellStarts[cell + 1] += _cellStarts[cell];
+    }
+    _cellExtremas.resize(extremas.size());
+    for (unsigned int i = 0; i < extremas.size(); ++i)
+    {
+        _cellExtremas[_cellStarts[cellIndex(extremas[i])]++] = i;
+    }
+    // Filling shifted each start to the next one
+    for (unsigned int cell = cellCount; cell > 0; --cell)
+    {
+        _cellStarts[cell] = _cellStarts[cell - 1];
+    }
+    _cellStarts[0] = 0;
+}
+
+/**
+ * @brief Lower given distance to the nearest extrema of a cell.
+ * @param column Column of the cell
+ * @param row Row of the cell
+ * @param layer Layer of the cell
+ * @param index Index of the extrema whose neighbour is searched (excluded from the search)
+ * @param nearest Current nearest distance
+ */
+void ExtremaGrid::searchCell(unsigned int column, unsigned int row, unsigned int layer, unsigned int index,
+    float & nearest) const
+{
+    const Extrema & extrema = (*_extremas)[index];
+    unsigned int cell = (layer * _rows + row) * _columns + column;
+
+    for (unsigned int i = _cellStarts[cell]; i < _cellStarts[cell + 1]; ++i)
+    {
+        if (_cellExtremas[i] != index)
+        {
+            float distance = extrema.distanceTo((*_extremas)[_cellExtremas[i]]);
+            if (distance < nearest)
+            {
+                nearest = distance;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Search the nearest neighbour of an extrema.
+ * Cells are searched in rings of growing radius around the cell of the extrema, until no
+ * unvisited cell can hold a nearer neighbour. In a volume, the rings are the shells of cubes. The search also stops as soon as a neighbour is
+ * known to be nearer than floor, or when no unvisited cell can hold a neighbour nearer than
+ * ceiling. The returned distance is then only a bound of the nearest distance.
+ * @param index Index of the extrema in the map given to build()
+ * @param floor Distance under which the exact nearest distance is not needed
+ * @param ceiling Distance over which the exact nearest distance is not needed
+ * @return Distance to the nearest other extrema found, infinity if there is none.
+ */
+float ExtremaGrid::search(unsigned int index, float floor, float ceiling) const
+{
+    const Extrema & extrema = (*_extremas)[index];
+    int column = (int)(extrema.x() / _cellSize);
+    int row = (int)(extrema.y() / _cellSize);
+    int layer = (int)(extrema.z() / _cellSize);
+    int maximumRadius = std::max(std::max(column, (int)_columns - 1 - column), std::max(row, (int)_rows - 1 - row));
+    maximumRadius = std::max(maximumRadius, std::max(layer, (int)_layers - 1 - layer));
+    float nearest = std::numeric_limits<float>::infinity();
+
+    for (int radius = 0; radius <= maximumRadius; ++radius)
+    {
+        int minColumn = std::max(0, column - radius);
+        int maxColumn = std::min((int)_columns - 1, column + radius);
+        int minRow = std::max(0, row - radius);
+        int maxRow = std::min((int)_rows - 1, row + radius);
+        int minLayer = std::max(0, layer - radius);
+        int maxLayer = std::min((int)_layers - 1, layer + radius);
+
+        for (int l = minLayer; l <= maxLayer; ++l)
+        {
+            bool face = l == layer - radius || l == layer + radius;
+
+            for (int r = minRow; r <= maxRow; ++r)
+            {
+                if (face || r == row - radius || r == row + radius)
+                {
+                    // Front or back face of the shell, or top or bottom side of the ring
+                    for (int c = minColumn; c <= maxColumn; ++c)
+                    {
+                        searchCell(c, r, l, index, nearest);
+                    }
+                }
+                else
+                {
+                    // Left and right sides of the ring
+                    if (column - radius >= 0)
+                    {
+                        searchCell(column - radius, r, l, index, nearest);
+                    }
+                    if (radius > 0 && column + radius < (int)_columns)
+                    {
+                        searchCell(column + radius, r, l, index, nearest);
+                    }
+                }
+            }
+        }
+
+        // Extremas outside of this ring are at least radius * cellSize + 1 pixels away
+        float bound = (float)(radius * _cellSize + 1);
+        if (nearest <= bound || nearest <= floor || bound >= ceiling)
+        {
+            break;
+        }
+    }
+
+    return nearest;
+}
+
+/**
+ * @brief Get the distance from an extrema to its nearest neighbour.
+ * @param index Index of the extrema in the map given to build()
+ * @return Distance to the nearest other extrema, infinity if there is none.
+ */
+float ExtremaGrid::nearestDistance(unsigned int index) const
+{
+    return search(index, 0.0f, std::numeric_limits<float>::infinity());
+}
+
+/**
+ * @brief Get the minimal nearest neighbour distance over the map (closest pair distance).
+ * Each search is abandoned once it cannot beat the closest pair found so far.
+ * @return Minimal nearest neighbour distance, infinity if the map holds less than two extremas.
+ */
+float ExtremaGrid::minimumNearestDistance() const
+{
+    float minimum = std::numeric_limits<float>::infinity();
+
+    for (unsigned int i = 0; i < _extremas->size(); ++i)
+    {
+        minimum = std::min(minimum, search(i, 0.0f, minimum));
+    }
+
+    return minimum;
+}
+
+/**
+ * @brief Get the maximal nearest neighbour distance over the map.
+ * Each search is abandoned once a neighbour nearer than the maximum found so far is met.
+ * @return Maximal nearest neighbour distance, infinity if the map holds less than two extremas.
+ */
+float ExtremaGrid::maximumNearestDistance() const
+{
+    float maximum = _extremas->size() < 2 ? std::numeric_limits<float>::infinity() : 0.0f;
+
+    for (unsigned int i = 0; i < _extremas->size(); ++i)
+    {
+        maximum = std::max(maximum, search(i, maximum, std::numeric_limits<float>::infinity()));
+    }
+
+    return maximum;
+}
@@ -0,0 +1,37 @@
+#ifndef __EXTREMA_GRID_H__
+#define __EXTREMA_GRID_H__
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "Extrema.h"
+
+class ExtremaGrid
+{
+private:
+    const std::vector<Extrema> * _extremas;
+    unsigned int _cellSize;
+    unsigned int _columns;
+    unsigned int _rows;
+    unsigned int _layers;
+    std::vector<unsigned int> _cellStarts;
+    std::vector<unsigned int> _cellExtremas;
+
+    unsigned int cellIndex(const Extrema & extrema) const;
+    void searchCell(unsigned int column, unsigned int row, unsigned int layer, unsigned int index,
+        float & nearest) const;
+    float search(unsigned int index, float floor, float ceiling) const;
+
+public:
+    ExtremaGrid();
+
+    void build(const std::vector<Extrema> & extremas, unsigned int width, unsigned int height,
+        unsigned int depth = 1);
+    float nearestDistance(unsigned int index) const;
+    float minimumNearestDistance() const;
+    float maximumNearestDistance() const;
+};
+
+#endif // __EXTREMA_GRID_H__
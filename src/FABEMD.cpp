@@ -2,6 +2,100 @@
 
 using namespace cimg_library;
 
+namespace
+{
+    enum WidthsCombination
+    {
+        COMBINE_MINIMUM,
+        COMBINE_MAXIMUM,
+        COMBINE_NONE
+    };
+
+    // Nearest extrema distance statistic of each map used by each OSFW type, and how both are combined
+    struct WidthsRule
+    {
+        bool largestMinima;
+        bool largestMaxima;
+        WidthsCombination combination;
+    };
+
+    const WidthsRule osfwWidthsRules[DIFFERENT_TYPE_4 + 1] =
+    {
+        { false, false, COMBINE_MINIMUM },  // SAME_TYPE_1
+        { false, false, COMBINE_MAXIMUM },  // SAME_TYPE_2
+        { true, true, COMBINE_MINIMUM },    // SAME_TYPE_3
+        { true, true, COMBINE_MAXIMUM },    // SAME_TYPE_4
+        { false, false, COMBINE_NONE },     // DIFFERENT_TYPE_1
+        { false, true, COMBINE_NONE },      // DIFFERENT_TYPE_2
+        { true, false, COMBINE_NONE },      // DIFFERENT_TYPE_3
+        { true, true, COMBINE_NONE }        // DIFFERENT_TYPE_4
+    };
+}
+
+/**
+ * @brief Store each image into its own image of a list.
+ * Images already in the list are overwritten in place, without allocation when their size matches.
+ */
+class FABEMD::ListOutput : public FABEMD::Output
+{
+private:
+    CImgList<float> & _images;
+
+public:
+    ListOutput(CImgList<float> & images) : _images(images) {}
+
+    bool write(unsigned int index, const CImg<float> & image)
+    {
+        if (index < _images.size())
+        {
+            _images[index] = image;
+        }
+        else
+        {
+            _images.insert(image);
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Store each image into a slice of a preallocated stack, or each volume into a channel.
+ */
+class FABEMD::StackOutput : public FABEMD::Output
+{
+private:
+    CImg<float> & _stack;
+
+public:
+    StackOutput(CImg<float> & stack) : _stack(stack) {}
+
+    bool write(unsigned int index, const CImg<float> & image)
+    {
+        if (image.depth() > 1)
+        {
+            _stack.get_shared_channel(index) = image;
+            return index + 1 < (unsigned int)_stack.spectrum();
+        }
+        _stack.get_shared_slice(index) = image;
+        return index + 1 < (unsigned int)_stack.depth();
+    }
+};
+
+/**
+ * @brief Create the default parameters, the same as the defaults of the FABEMD constructor.
+ * Distance backend is DISTANCE_GRID, and neither the BEMC count nor the energy is limited.
+ */
+FABEMD::Parameters::Parameters()
+{
+    osfwType = SAME_TYPE_1;
+    maximumAllowableIterations = 1;
+    size = 3;
+    threshold = 0.05f;
+    distanceBackend = DISTANCE_GRID;
+    maximumBimfCount = 0;
+    energyThreshold = 0.0f;
+}
+
 /**
  * @brief Prepare a Fast and Adaptive Bidimensional Empirical Mode Decomposition of given image.
  * Algorithm can be executed using the execute() method.
@@ -16,20 +110,167 @@ FABEMD::FABEMD(const CImg<float> & input,
     unsigned int maximumAllowableIterations, 
     unsigned int size, 
     float threshold)
+{
+    Parameters parameters;
+    parameters.osfwType = osfwType;
+    parameters.maximumAllowableIterations = maximumAllowableIterations;
+    parameters.size = size;
+    parameters.threshold = threshold;
+    initialize(input, parameters);
+}
+
+/**
+ * @brief Prepare a decomposition of given image with given parameters.
+ * @param input Source image
+ * @param parameters Parameters of the decomposition
+ */
+FABEMD::FABEMD(const CImg<float> & input, const Parameters & parameters)
+{
+    initialize(input, parameters);
+}
+
+/**
+ * @brief Set up the decomposition of given image with given parameters.
+ * @param input Source image
+ * @param parameters Parameters of the decomposition
+ */
+void FABEMD::initialize(const CImg<float> & input, const Parameters & parameters)
 {
     _input = input.get_channel(0);
     _width = (unsigned int)_input.width();
     _height = (unsigned int)_input.height();
+    _depth = (unsigned int)_input.depth();
+
+    _size = parameters.size;
+    _threshold = parameters.threshold;
+    _maximumAllowableIterations = parameters.maximumAllowableIterations;
+    _osfwType = parameters.osfwType;
+    _distanceBackend = parameters.distanceBackend;
+    _extremaCount = 0;
+    _threadPool = 0;
+    _workspace = 0;
+    _maximumBimfCount = parameters.maximumBimfCount;
+    _energyThreshold = parameters.energyThreshold;
+    _inputMean = 0.0;
+    _inputEnergy = 0.0;
+    _verbose = true;
+    _residueKept = false;
+}
+
+/**
+ * @brief Replace the image decomposed, keeping the parameters, the pool and the workspace.
+ * The first channel of an image of the same size is copied in place, without allocation.
+ * @param input Source image
+ */
+void FABEMD::setInput(const CImg<float> & input)
+{
+    if ((unsigned int)input.width() == _width && (unsigned int)input.height() == _height &&
+        (unsigned int)input.depth() == _depth)
+    {
+        std::copy(input.data(), input.data() + _input.size(), _input.data());
+        return;
+    }
+
+    _input = input.get_channel(0);
+    _width = (unsigned int)_input.width();
+    _height = (unsigned int)_input.height();
+    _depth = (unsigned int)_input.depth();
+}
+
+/**
+ * @brief Limit the number of BEMCs extracted.
+ * Once this number of BEMCs is extracted, the remaining signal is output as the residue.
+ * @param maximumBimfCount Maximal number of BEMCs, 0 for no limit (the default)
+ */
+void FABEMD::setMaximumBimfCount(unsigned int maximumBimfCount)
+{
+    _maximumBimfCount = maximumBimfCount;
+}
+
+/**
+ * @brief Stop extracting BEMCs once the remaining signal holds little energy.
+ * Energies are measured around the mean of the original image, which the residue tends to. When
+ * the energy of the remaining signal falls below given fraction of the energy of the original
+ * image, the remaining signal is output as the residue.
+ * @param energyThreshold Fraction of the original image energy, 0 to never stop (the default)
+ */
+void FABEMD::setEnergyThreshold(float energyThreshold)
+{
+    _energyThreshold = energyThreshold;
+}
+
+/**
+ * @brief Print the progress of the decomposition on the standard output, which is the default.
+ * @param verbose True to print the progress
+ */
+void FABEMD::setVerbose(bool verbose)
+{
+    _verbose = verbose;
+}
+
+/**
+ * @brief Select the method used to find the distance from each extrema to its nearest neighbour.
+ * - DISTANCE_GRID: extremas are bucketed in a uniform grid, fastest when extremas are sparse
+ * - DISTANCE_TRANSFORM: exact Euclidean distance transform, linear in the number of pixels
+ * Volumes always use the grid, the distance transform being 2D only.
+ * @param distanceBackend Nearest extrema search method
+ */
+void FABEMD::setDistanceBackend(DistanceBackend distanceBackend)
+{
+    _distanceBackend = distanceBackend;
+}
+
+/**
+ * @brief Share a pool of workers with the decomposition.
+ * Without a pool (the default), the decomposition runs on the calling thread only.
+ * @param threadPool Pool of workers, which must outlive the decomposition, or 0
+ */
+void FABEMD::setThreadPool(ThreadPool * threadPool)
+{
+    _threadPool = threadPool;
+}
+
+/**
+ * @brief Share a workspace with the decomposition.
+ * Buffers of a workspace are reused by every decomposition of images of the same size, so that
+ * a workspace reused by successive decompositions saves their allocations. Without a shared
+ * workspace (the default), the decomposition uses its own.
+ * @param workspace Workspace, which must outlive the decomposition, or 0
+ */
+void FABEMD::setWorkspace(Workspace * workspace)
+{
+    _workspace = workspace;
+}
+
+/**
+ * @brief Get the workspace holding the buffers of the decomposition.
+ * @return Shared workspace if any, else own workspace.
+ */
+Workspace & FABEMD::workspace()
+{
+    return _workspace ? *_workspace : _ownWorkspace;
+}
 
-    _bimf = CImg<float>(_input);
-    _lowerEnvelope = CImg<float>(_width, _height);
-    _upperEnvelope = CImg<float>(_width, _height);
-    _averageEnvelope = CImg<float>(_width, _height);
+/**
+ * @brief Set the workspace up for a decomposition of this image.
+ * Buffers are only allocated by the first decomposition of an image of this size.
+ */
+void FABEMD::prepareWorkspace()
+{
+    workspace().reserve(_width, _height, _depth);
+    workspace().detector().setSize(_size);
+    workspace().detector().setThreadPool(_threadPool);
+    workspace().filter().setThreadPool(_threadPool);
+}
 
-    _size = size;
-    _threshold = threshold;
-    _maximumAllowableIterations = maximumAllowableIterations;
-    _osfwType = osfwType;
+/**
+ * @brief Get the nearest extrema search method actually used.
+ * The distance transform only handles 2D images, so that volumes always use the grid.
+ * @return Selected distance backend, or DISTANCE_GRID for a volume.
+ */
+DistanceBackend FABEMD::distanceBackend() const
+{
+    return _depth > 1 ? DISTANCE_GRID : _distanceBackend;
 }
 
 /**
@@ -37,111 +278,255 @@ FABEMD::FABEMD(const CImg<float> & input,
  */
 void FABEMD::buildExtremasMaps()
 {
-    _localMinimas.clear();
-    _localMaximas.clear();
+    std::vector<Extrema> & minimas = workspace().localMinimas();
+    std::vector<Extrema> & maximas = workspace().localMaximas();
 
-    // Loop over image pixels
-    cimg_forXY(_bimf, m, n)
-    {
-        bool isMaxima = true;
-        bool isMinima = true;
-        unsigned int minK = (unsigned int)std::max(0, (int)(m - (_size - 1) / 2));
-        unsigned int minL = (unsigned int)std::max(0, (int)(n - (_size - 1) / 2));
-        unsigned int maxK = (unsigned int)std::min((int)(_width - 1), (int)(m + (_size - 1) / 2));
-        unsigned int maxL = (unsigned int)std::min((int)(_height - 1), (int)(n + (_size - 1) / 2));
-        unsigned int k = minK;
-        unsigned int l = minL;
+    workspace().detector().detect(workspace().bimf(), minimas, maximas);
+    _extremaCount = (unsigned int)(minimas.size() + maximas.size());
+}
 
-        // Loop over (m,n) neighborhood
-        while ((isMinima || isMaxima) && k <= maxK)
-        {
-            while ((isMinima || isMaxima) && l <= maxL)
-            {
-                if (k != (unsigned int)m || l != (unsigned int)n)
-                {
-                    if (_bimf(k, l) >= _bimf(m, n))
-                    {
-                        isMaxima = false;
-                    }
-                    if (_bimf(k, l) <= _bimf(m, n))
-                    {
-                        isMinima = false;
-                    }
+/**
+ * @brief Count the minimas and maximas of this image, without building their maps.
+ * @param limit Count from which counting stops early
+ */
+void FABEMD::countExtremas(unsigned int limit)
+{
+    _extremaCount = workspace().detector().count(workspace().bimf(), limit);
+}
 
-                }
-                ++l;
-            }
-            l = minL;
-            ++k;
-        }
+/**
+ * @brief Assign the minimal distance to another extrema for each extrema of given map.
+ * Depending on the distance backend, extremas are either bucketed in a uniform grid so that only
+ * the cells around each extrema are searched, or their distances are read from a Euclidean
+ * distance transform of the extrema map.
+ * @param extremas Extrema map.
+ */
+void FABEMD::assignNearests(std::vector<Extrema> & extremas)
+{
+    switch (distanceBackend())
+    {
+    case DISTANCE_TRANSFORM:
+        workspace().distanceTransform().assignNearests(extremas, _width, _height);
+        break;
+    case DISTANCE_GRID:
+    default:
+        workspace().grid().build(extremas, _width, _height, _depth);
 
-        // Add point to local maxima (minima) map if strictly higher (lower) than each of its neighbour
-        if (isMaxima)
+        // Get distance to nearest extrema for each extrema
+        for (unsigned int i = 0; i < extremas.size(); ++i)
         {
-            _localMaximas.push_back(Extrema(m, n));
+            extremas[i].setDistance(workspace().grid().nearestDistance(i));
         }
-        if (isMinima)
+        break;
+    }
+}
+
+/**
+ * @brief Get the minimal distance between two extremas of given map.
+ * With the grid backend, this is solved as a closest pair problem, without computing the distance
+ * from every extrema to its nearest neighbour.
+ * @param extremas Extrema map.
+ * @return Minimal nearest extrema distance, infinity if the map holds less than two extremas.
+ */
+float FABEMD::minimumNearestDistance(std::vector<Extrema> & extremas)
+{
+    float minimum = std::numeric_limits<float>::infinity();
+
+    switch (distanceBackend())
+    {
+    case DISTANCE_TRANSFORM:
+        assignNearests(extremas);
+        for (std::vector<Extrema>::const_iterator i = extremas.begin(); i != extremas.end(); ++i)
         {
-            _localMinimas.push_back(Extrema(m, n));
+            minimum = std::min(minimum, i->distance());
         }
+        break;
+    case DISTANCE_GRID:
+    default:
+        workspace().grid().build(extremas, _width, _height, _depth);
+        minimum = workspace().grid().minimumNearestDistance();
+        break;
     }
+
+    return minimum;
 }
 
 /**
- * @brief Assign the minimal distance to another extrema for each extrema of given map.
+ * @brief Get the maximal distance from an extrema of given map to its nearest neighbour.
  * @param extremas Extrema map.
+ * @return Maximal nearest extrema distance, infinity if the map holds less than two extremas.
  */
-void FABEMD::assignNearests(std::vector<Extrema> & extremas)
+float FABEMD::maximumNearestDistance(std::vector<Extrema> & extremas)
 {
-    // Get distance to nearest extrema for each extrema
-    for (std::vector<Extrema>::iterator i = extremas.begin(); i != extremas.end(); ++i)
+    float maximum = extremas.size() < 2 ? std::numeric_limits<float>::infinity() : 0.0f;
+
+    switch (distanceBackend())
     {
-        for (std::vector<Extrema>::iterator j = i + 1; j != extremas.end(); ++j)
+    case DISTANCE_TRANSFORM:
+        assignNearests(extremas);
+        for (std::vector<Extrema>::const_iterator i = extremas.begin(); i != extremas.end(); ++i)
         {
-            float distance = i->distanceTo(*j);
+            maximum = std::max(maximum, i->distance());
+        }
+        break;
+    case DISTANCE_GRID:
+    default:
+        workspace().grid().build(extremas, _width, _height, _depth);
+        maximum = workspace().grid().maximumNearestDistance();
+        break;
+    }
 
-            if (i->distance() > distance)
-            {
-                i->setDistance(distance);
-            }
+    return maximum;
+}
 
-            if (j->distance() > distance)
-            {
-                j->setDistance(distance);
-            }
+/**
+ * @brief Get both the minimal and the maximal distance from an extrema of given map to its nearest
+ * neighbour, searching the nearest extremas only once.
+ * @param extremas Extrema map.
+ * @param minimum Minimal nearest extrema distance, infinity if the map holds less than two extremas
+ * @param maximum Maximal nearest extrema distance, infinity if the map holds less than two extremas
+ */
+void FABEMD::nearestDistances(std::vector<Extrema> & extremas, float & minimum, float & maximum)
+{
+    switch (distanceBackend())
+    {
+    case DISTANCE_TRANSFORM:
+        minimum = std::numeric_limits<float>::infinity();
+        maximum = extremas.size() < 2 ? std::numeric_limits<float>::infinity() : 0.0f;
+        assignNearests(extremas);
+        for (std::vector<Extrema>::const_iterator i = extremas.begin(); i != extremas.end(); ++i)
+        {
+            minimum = std::min(minimum, i->distance());
+            maximum = std::max(maximum, i->distance());
         }
+        break;
+    case DISTANCE_GRID:
+    default:
+        workspace().grid().build(extremas, _width, _height, _depth);
+        minimum = workspace().grid().minimumNearestDistance();
+        maximum = workspace().grid().maximumNearestDistance();
+        break;
     }
 }
 
 /**
- * @brief Get standard deviation of F_{T_{j+1}}.
+ * @brief Subtract the mean envelope from F_{T_j} to get F_{T_{j+1}}, and get the standard
+ * deviation used as stop criterion, in a single pass over both smoothed envelopes.
+ * The mean envelope is also accumulated into the residue, which ends up as S_{i+1} = S_i - F_i.
  * @return Standard deviation of F_{T_{j+1}}.
  */
-float FABEMD::standardDeviation()
+float FABEMD::subtractAverageEnvelope()
 {
+    const float * lower = workspace().lowerEnvelope().data();
+    const float * upper = workspace().upperEnvelope().data();
+    float * bimf = workspace().bimf().data();
+    float * residue = workspace().residue().data();
+    const unsigned int count = _width * _height * _depth;
+
     float meValue = 0.0;
     float ftjValue = 0.0;
-    cimg_forXY(_averageEnvelope, x, y)
+    for (unsigned int k = 0; k < count; ++k)
     {
-        meValue += _averageEnvelope(x, y) * _averageEnvelope(x, y);
-        ftjValue += _bimf(x, y) * _bimf(x, y);
+        // (vii) Find the mean/average envelope (ME) as M_{E_j} = (U_{E_j} + L_{E_j}) / 2.
+        const float average = (lower[k] + upper[k]) / 2.0f;
+        meValue += average * average;
+        ftjValue += bimf[k] * bimf[k];
+
+        // (viii) Calculate F_{T_{j+1}} as F_{T_{j+1}} = F_{T_j} - M_{E_j}
+        bimf[k] -= average;
+        residue[k] += average;
     }
 
     return meValue / ftjValue;
 }
 
+/**
+ * @brief Get the energy of the variations of given image around a value.
+ * @param image Source image
+ * @param mean Value around which variations are measured
+ * @return Sum of the squared differences between the pixels and the value.
+ */
+double FABEMD::energy(const CImg<float> & image, double mean)
+{
+    double sum = 0.0;
+    cimg_for(image, value, float)
+    {
+        sum += (*value - mean) * (*value - mean);
+    }
+
+    return sum;
+}
+
+/**
+ * @brief Tell whether the decomposition must stop, the remaining signal being output as residue.
+ * @param bimfCount Number of BEMCs extracted
+ * @return True if the BEMC count or the remaining signal energy limit is reached.
+ */
+bool FABEMD::limitReached(unsigned int bimfCount)
+{
+    if (_maximumBimfCount > 0 && bimfCount >= _maximumBimfCount)
+    {
+        return true;
+    }
+
+    return _energyThreshold > 0.0f && energy(workspace().residue(), _inputMean) < _energyThreshold * _inputEnergy;
+}
+
 /**
  * @brief Get current extrema count.
- * @return Current extrema count.
+ * @return Current extrema count, which stops at the counting limit when the maps were not built.
  */
 unsigned int FABEMD::extremaCount()
 {
-    return (unsigned int)(_localMinimas.size() + _localMaximas.size());
+    return _extremaCount;
 }
 
 /**
- * @brief Compute order statistics filter widths.
- * The values assigned depend on fabemd's osfw type. Possible values are the following:
+ * @brief Compute order statistics filter widths of fabemd's osfw type.
+ * Only the nearest extrema distance statistics required by the type are computed.
+ */
+void FABEMD::computeFiltersWidths()
+{
+    bool largestMinima;
+    bool largestMaxima;
+    float minimaDistance = 0.0f;
+    float maximaDistance = 0.0f;
+
+    if (nearestDistanceStatistics(_osfwType, largestMinima, largestMaxima))
+    {
+        std::vector<Extrema> & minimas = workspace().localMinimas();
+        std::vector<Extrema> & maximas = workspace().localMaximas();
+        minimaDistance = largestMinima ? maximumNearestDistance(minimas) : minimumNearestDistance(minimas);
+        maximaDistance = largestMaxima ? maximumNearestDistance(maximas) : minimumNearestDistance(maximas);
+    }
+    filtersWidths(_osfwType, minimaDistance, maximaDistance, largestDimension(), _windowWidthMin, _windowWidthMax);
+}
+
+/**
+ * @brief Tell which nearest extrema distance statistic of each map an order statistics filter
+ * widths type uses, as listed by filtersWidths().
+ * @param osfwType Order statistics filter widths type
+ * @param largestMinima True for the maximal nearest minima distance, false for the minimal one
+ * @param largestMaxima True for the maximal nearest maxima distance, false for the minimal one
+ * @return False for an unknown type, whose widths do not depend on the distances.
+ */
+bool FABEMD::nearestDistanceStatistics(OSFW osfwType, bool & largestMinima, bool & largestMaxima)
+{
+    if (osfwType < SAME_TYPE_1 || osfwType > DIFFERENT_TYPE_4)
+    {
+        largestMinima = false;
+        largestMaxima = false;
+        return false;
+    }
+
+    largestMinima = osfwWidthsRules[osfwType].largestMinima;
+    largestMaxima = osfwWidthsRules[osfwType].largestMaxima;
+    return true;
+}
+
+/**
+ * @brief Get the order statistics filters widths of a type from the nearest extrema distance
+ * statistics given by nearestDistanceStatistics(). Possible values are the following:
  * - SAME_TYPE_1: w_{en-g} = minimum{minimum{d_{adj-max}, minimum{d_{adj-min}}
  * - SAME_TYPE_2: w_{en-g} = maximum{minimum{d_{adj-max}, minimum{d_{adj-min}}
  * - SAME_TYPE_3: w_{en-g} = minimum{maximum{d_{adj-max}, maximum{d_{adj-min}}
@@ -154,151 +539,183 @@ unsigned int FABEMD::extremaCount()
  *                     w_{maxen-g} = minimum{d_{adj-max}
  * - DIFFERENT_TYPE_4: w_{minen-g} = maximum{d_{adj-min}
  *                     w_{maxen-g} = maximum{d_{adj-max}
+ * Even widths are rounded up to odd ones, and unknown types get widths of 3.
+ * A distance is infinite when a map has less than 2 extremas: distances are clamped to the largest
+ * dimension of the image, as wider filters would not change the envelopes.
+ * @param osfwType Order statistics filter widths type
+ * @param minimaDistance Nearest minima distance statistic of the type
+ * @param maximaDistance Nearest maxima distance statistic of the type
+ * @param largestDimension Largest dimension of the image
+ * @param windowWidthMin Width of the order statistics filter of the lower envelope
+ * @param windowWidthMax Width of the order statistics filter of the upper envelope
  */
-void FABEMD::computeFiltersWidths()
+void FABEMD::filtersWidths(OSFW osfwType, float minimaDistance, float maximaDistance, unsigned int largestDimension,
+    unsigned int & windowWidthMin, unsigned int & windowWidthMax)
 {
-    switch (_osfwType)
+    if (osfwType < SAME_TYPE_1 || osfwType > DIFFERENT_TYPE_4)
     {
-    case SAME_TYPE_1:
-        _windowWidthMin = (unsigned int)std::min(
-            _localMinimas.rbegin()->distance(),
-            _localMaximas.begin()->distance());
-        _windowWidthMax = _windowWidthMin;
-        break;
-    case SAME_TYPE_2:
-        _windowWidthMin = (unsigned int)std::max(
-            _localMinimas.rbegin()->distance(),
-            _localMaximas.begin()->distance());
-        _windowWidthMax = _windowWidthMin;
-        break;
-    case SAME_TYPE_3:
-        _windowWidthMin = (unsigned int)std::min(
-            _localMinimas.begin()->distance(),
-            _localMaximas.rbegin()->distance());
-        _windowWidthMax = _windowWidthMin;
-        break;
-    case SAME_TYPE_4:
-        _windowWidthMin = (unsigned int)std::max(
-            _localMinimas.begin()->distance(),
-            _localMaximas.rbegin()->distance());
-        _windowWidthMax = _windowWidthMin;
-        break;
-    case DIFFERENT_TYPE_1:
-        _windowWidthMin = (unsigned int)_localMinimas.rbegin()->distance();
-        _windowWidthMax = (unsigned int)_localMaximas.begin()->distance();
-        break;
-    case DIFFERENT_TYPE_2:
-        _windowWidthMin = (unsigned int)_localMinimas.rbegin()->distance();
-        _windowWidthMax = (unsigned int)_localMaximas.rbegin()->distance();
-        break;
-    case DIFFERENT_TYPE_3:
-        _windowWidthMin = (unsigned int)_localMinimas.begin()->distance();
-        _windowWidthMax = (unsigned int)_localMaximas.begin()->distance();
+        windowWidthMin = 3;
+        windowWidthMax = 3;
+        return;
+    }
+
+    // Also catches not-a-number distances, whose conversion to an integer is undefined
+    const float bound = (float)largestDimension;
+    if (!(minimaDistance <= bound))
+    {
+        minimaDistance = bound;
+    }
+    if (!(maximaDistance <= bound))
+    {
+        maximaDistance = bound;
+    }
+
+    switch (osfwWidthsRules[osfwType].combination)
+    {
+    case COMBINE_MINIMUM:
+        windowWidthMin = (unsigned int)std::min(minimaDistance, maximaDistance);
+        windowWidthMax = windowWidthMin;
         break;
-    case DIFFERENT_TYPE_4:
-        _windowWidthMin = (unsigned int)_localMinimas.begin()->distance();
-        _windowWidthMax = (unsigned int)_localMaximas.rbegin()->distance();
+    case COMBINE_MAXIMUM:
+        windowWidthMin = (unsigned int)std::max(minimaDistance, maximaDistance);
+        windowWidthMax = windowWidthMin;
         break;
+    case COMBINE_NONE:
     default:
-        _windowWidthMin = 3;
-        _windowWidthMax = 3;
+        windowWidthMin = (unsigned int)minimaDistance;
+        windowWidthMax = (unsigned int)maximaDistance;
         break;
     }
 
-    if (_windowWidthMin % 2 == 0)
+    if (windowWidthMin % 2 == 0)
     {
-        ++_windowWidthMin;
+        ++windowWidthMin;
     }
-    if (_windowWidthMax % 2 == 0)
+    if (windowWidthMax % 2 == 0)
     {
-        ++_windowWidthMax;
+        ++windowWidthMax;
     }
 }
 
 /**
  * @brief Compute lower envelope.
+ * The minimum over the order statistics window is computed by a separable running filter,
+ * whose cost per pixel does not depend on the window width.
  */
 void FABEMD::computeLowerEnvelope()
 {
-    cimg_forXY(_lowerEnvelope, m, n)
-    {
-        unsigned int minK = (unsigned int)std::max(0, (int)(m - (_windowWidthMin - 1) / 2));
-        unsigned int minL = (unsigned int)std::max(0, (int)(n - (_windowWidthMin - 1) / 2));
-        unsigned int maxK = (unsigned int)std::min((int)(_width - 1), (int)(m + (_windowWidthMin - 1) / 2));
-        unsigned int maxL = (unsigned int)std::min((int)(_height - 1), (int)(n + (_windowWidthMin - 1) / 2));
-        unsigned int k = minK;
-        unsigned int l = minL;
-        float value = std::numeric_limits<float>::infinity();
-
-        // Loop over (m,n) neighborhood
-        while (k <= maxK)
-        {
-            while (l <= maxL)
-            {
-                if (_bimf(k, l) < value)
-                {
-                    value = _bimf(k, l);
-                }
-                ++l;
-            }
-            l = minL;
-            ++k;
-        }
-        _lowerEnvelope(m, n) = value;
-    }
+    workspace().filter().minimum(workspace().bimf(), workspace().lowerEnvelope(), _windowWidthMin);
 }
 
 /**
  * @brief Compute upper enveloppe.
+ * The maximum over the order statistics window is computed by a separable running filter,
+ * whose cost per pixel does not depend on the window width.
  */
 void FABEMD::computeUpperEnvelope()
 {
-    cimg_forXY(_upperEnvelope, m, n)
+    workspace().filter().maximum(workspace().bimf(), workspace().upperEnvelope(), _windowWidthMax);
+}
+
+/**
+ * @brief Compute lower and upper envelopes.
+ * When both order statistics filters have the same width, as with SAME_TYPE_* widths, both
+ * envelopes are computed from a single read of the image.
+ */
+void FABEMD::computeEnvelopes()
+{
+    if (_windowWidthMin == _windowWidthMax)
+    {
+        workspace().filter().minimumMaximum(workspace().bimf(), workspace().lowerEnvelope(), workspace().upperEnvelope(), _windowWidthMin);
+    }
+    else
     {
-        unsigned int minK = (unsigned int)std::max(0, (int)(m - (_windowWidthMax - 1) / 2));
-        unsigned int minL = (unsigned int)std::max(0, (int)(n - (_windowWidthMax - 1) / 2));
-        unsigned int maxK = (unsigned int)std::min((int)(_width - 1), (int)(m + (_windowWidthMax - 1) / 2));
-        unsigned int maxL = (unsigned int)std::min((int)(_height - 1), (int)(n + (_windowWidthMax - 1) / 2));
-        unsigned int k = minK;
-        unsigned int l = minL;
-        float value = -std::numeric_limits<float>::infinity();
+        computeLowerEnvelope();
+        computeUpperEnvelope();
+    }
+}
 
-        // Loop over (m,n) neighborhood
-        while (k <= maxK)
-        {
-            while (l <= maxL)
-            {
-                if (_bimf(k, l) > value)
-                {
-                    value = _bimf(k, l);
-                }
-                ++l;
-            }
-            l = minL;
-            ++k;
-        }
-        _upperEnvelope(m, n) = value;
+/**
+ * @brief Smooth lower and upper envelopes.
+ * Each envelope is averaged over the window of its order statistics filter, by a running sum
+ * whose cost per pixel does not depend on the window width.
+ */
+void FABEMD::smoothEnvelopes()
+{
+    workspace().filter().average(workspace().lowerEnvelope(), workspace().lowerEnvelope(), _windowWidthMin);
+    workspace().filter().average(workspace().upperEnvelope(), workspace().upperEnvelope(), _windowWidthMax);
+}
+
+/**
+ * @brief Compute the order statistics filters widths of the first BEMC, without decomposing.
+ * Used to set the widths of a StreamingFABEMD, which cannot know them before the whole image is
+ * received.
+ * @param windowWidthMin Width of the order statistics filter of the lower envelope
+ * @param windowWidthMax Width of the order statistics filter of the upper envelope
+ * @return Number of extremas of the image, both widths being 3 when it has less than 3 extremas.
+ */
+unsigned int FABEMD::firstFiltersWidths(unsigned int & windowWidthMin, unsigned int & windowWidthMax)
+{
+    prepareWorkspace();
+    workspace().bimf() = _input;
+
+    buildExtremasMaps();
+    if (extremaCount() >= 3)
+    {
+        computeFiltersWidths();
+    }
+    else
+    {
+        _windowWidthMin = 3;
+        _windowWidthMax = 3;
     }
+
+    windowWidthMin = _windowWidthMin;
+    windowWidthMax = _windowWidthMax;
+    return extremaCount();
 }
 
 /**
- * @brief Execute computation of BEMC and residue.
- * @return Image composed of the following slices :
- * - The original image
+ * @brief Execute computation of BEMC and residue, handing each image to given output as soon as
+ * it is computed. Images are not kept by the decomposition, so that its memory does not grow with
+ * the number of BEMCs. The output receives, in order, with increasing indices:
+ * - The original image (index 0)
  * - Every computed BEMC
- * - The residue
+ * - The residue, only when a BEMC count or energy limit is reached, as residueKept() then tells
+ * Each image is only valid during the call to Output::write(), which returns false to stop the
+ * decomposition after this image.
+ * @param output Destination of the images
+ * @return Number of images written.
  */
-CImg<float> FABEMD::execute()
+unsigned int FABEMD::execute(Output & output)
 {
-    CImg<float> display = CImg<float>(_input);
+    unsigned int count = 1;
+    _residueKept = false;
+    if (!output.write(0, _input))
+    {
+        return count;
+    }
+
+    prepareWorkspace();
+    CImg<float> & residue = workspace().residue();
+    CImg<float> & bimf = workspace().bimf();
 
     // (i) Set i = 1. Take I and set S_i = I
     unsigned int i = 1;
+    residue = _input;
+    if (_energyThreshold > 0.0f)
+    {
+        _inputMean = _input.mean();
+        _inputEnergy = energy(_input, _inputMean);
+    }
     do
     {
         // (ii) Set j = 1. Set F_{T_j} = S_i.
+        // Buffers are swapped rather than copied, the residue buffer then accumulating the mean envelopes
         unsigned int j = 1;
-        _bimf = _input;
+        unsigned int extremas = 0;
+        residue.swap(bimf);
+        residue.fill(0.0f);
         do
         {
             //-----------------------------------------------------------------
@@ -306,13 +723,25 @@ CImg<float> FABEMD::execute()
             //-----------------------------------------------------------------
             // (v) Obtain the local minima map (LMMIN) of F_{T_j}, denoted as Q_j.
             // (iii) Obtain the local maxima map (LMMAX) of F_{T_j}, denoted as P_j.
-            buildExtremasMaps();
+            // Maps are only used to get the filters widths when j equals 1, afterwards counting is enough
+            if (j == 1)
+            {
+                buildExtremasMaps();
+                extremas = extremaCount();
+            }
+            else
+            {
+                countExtremas(3);
+            }
 
             // Exit if previous created BEMC had less than 3 extremas
             if (extremaCount() < 3)
             {
-                std::cout << "BIMF has less than 3 extremas" << std::endl;
-                return display;
+                if (_verbose)
+                {
+                    std::cout << "BIMF has less than 3 extremas" << std::endl;
+                }
+                return count;
             }
 
             // The order statistics filters are based on maxima and minima maps of a S_i image (if j equals 1)
@@ -322,55 +751,297 @@ CImg<float> FABEMD::execute()
                 // 3.2. Generating upper and lower envelopes
                 //-----------------------------------------------------------------
                 // 3.2.1. Determining window size for order-statistics filters
-                assignNearests(_localMinimas);
-                std::sort(_localMinimas.begin(), _localMinimas.end(), Extrema::Greater());
-                assignNearests(_localMaximas);
-                std::sort(_localMaximas.begin(), _localMaximas.end(), Extrema::Less());
                 computeFiltersWidths();
-
-                // Create smoothing kernels
-                _lowerKernel = CImg<float>(_windowWidthMin, _windowWidthMin, 1, 1,
-                    1.0f / (_windowWidthMin * _windowWidthMin));
-                _upperKernel = CImg<float>(_windowWidthMax, _windowWidthMax, 1, 1,
-                    1.0f / (_windowWidthMax * _windowWidthMax));
             }
 
             // 3.2.2. Applying order statistics and smoothing filters
             // (vi) Form the lower envelope (LE) of F_{T_j}, denoted as L_{E_j} by interpolating the minima points in Q_j
-            computeLowerEnvelope();
-            // Smooth lower envelope
-            _lowerEnvelope.convolve(_lowerKernel);
-
             // (iv) Form the upper envelope (UE) of F_{T_j}, denoted as U_{E_j} by interpolating the minima points in P_j
-            computeUpperEnvelope();
-            // Smooth upper envelope
-            _upperEnvelope.convolve(_upperKernel);
+            computeEnvelopes();
 
-            // (vii) Find the mean/average envelope (ME) as M_{E_j} = (U_{E_j} + L_{E_j}) / 2.
-            _averageEnvelope = (_lowerEnvelope + _upperEnvelope) / 2.0;
+            // Smooth lower and upper envelopes
+            smoothEnvelopes();
 
-            // Compute variance of F_{T_{j+1}}
-            _variance = standardDeviation();
-            std::cout << "ITS-BIMF-" << i << "-" << j << ": " << "variance of " << _variance << "." << std::endl;
-
-            // (viii) Calculate F_{T_{j+1}} as F_{T_{j+1}} = F_{T_j} - M_{E_j}
+            // (vii) Find the mean envelope and (viii) subtract it from F_{T_j}, computing variance of F_{T_{j+1}}
+            _variance = subtractAverageEnvelope();
+            if (_verbose)
+            {
+                std::cout << "ITS-BIMF-" << i << "-" << j << ": " << "variance of " << _variance << "." << std::endl;
+            }
             ++j;
-            _bimf -= _averageEnvelope;
 
             // (ix) Check whether F_{T_{j+1}} follows the BIMF properties
         } while (_variance > _threshold && j <= _maximumAllowableIterations);
 
-        std::cout << "BIMF-" << i << ": " << extremaCount() << " extremas." << std::endl;
+        if (_verbose)
+        {
+            std::cout << "BIMF-" << i << ": " << extremas << " extremas." << std::endl;
+        }
         ++i;
 
-        // (x) S_i = S_{i-1} - F_{i-1}
-        _input -= _bimf;
+        // (x) S_i = S_{i-1} - F_{i-1}, accumulated in the residue buffer as the sum of the mean envelopes
 
-        // Add BEMC (or residue) to output
-        display.append(CImg<float>(_bimf), 'z');
+        // Add BEMC (or residue) to output, stopping if asked to
+        if (!output.write(count++, bimf))
+        {
+            return count;
+        }
+
+        // Fold the remaining signal S_i into the residue when a limit is reached
+        if (extremaCount() >= 3 && limitReached(i - 1))
+        {
+            if (_verbose)
+            {
+                std::cout << "Residue kept after " << i - 1 << " BIMFs." << std::endl;
+            }
+            output.write(count++, residue);
+            _residueKept = true;
+            return count;
+        }
 
         // (xi) Determine whether S_i has less than three extrema points
     } while (extremaCount() >= 3);
 
-    return display;
+    return count;
+}
+
+/**
+ * @brief Decompose one level of the sweep for a group of types sharing the previous levels.
+ * The extrema maps of the level and their nearest extrema distances are computed once, and the
+ * types whose widths agree are decomposed together by sweepBranch().
+ * @param node Types sharing the previous levels, remaining signal S_i and index i of the BEMC computed
+ * @param results Lists of images of every type
+ * @param pending Nodes left to decompose, to which the nodes of the next level are added
+ * @return Number of BEMCs computed at this level.
+ */
+unsigned int FABEMD::sweepLevel(const SweepNode & node, std::vector<CImgList<float> > & results,
+    std::vector<SweepNode> & pending)
+{
+    const std::vector<OSFW> & types = node.types;
+    const unsigned int level = node.level;
+    workspace().bimf() = node.signal;
+    buildExtremasMaps();
+    if (extremaCount() < 3)
+    {
+        return 0;
+    }
+
+    float minimaDistances[2];
+    float maximaDistances[2];
+    nearestDistances(workspace().localMinimas(), minimaDistances[0], minimaDistances[1]);
+    nearestDistances(workspace().localMaximas(), maximaDistances[0], maximaDistances[1]);
+
+    std::vector<unsigned int> widthsMin(types.size());
+    std::vector<unsigned int> widthsMax(types.size());
+    for (unsigned int k = 0; k < types.size(); ++k)
+    {
+        bool largestMinima;
+        bool largestMaxima;
+        nearestDistanceStatistics(types[k], largestMinima, largestMaxima);
+        filtersWidths(types[k], minimaDistances[largestMinima], maximaDistances[largestMaxima], largestDimension(),
+            widthsMin[k], widthsMax[k]);
+    }
+
+    // Types are grouped by widths, each group being decomposed once
+    unsigned int count = 0;
+    std::vector<bool> grouped(types.size(), false);
+    for (unsigned int k = 0; k < types.size(); ++k)
+    {
+        if (grouped[k])
+        {
+            continue;
+        }
+
+        std::vector<OSFW> group;
+        for (unsigned int l = k; l < types.size(); ++l)
+        {
+            if (widthsMin[l] == widthsMin[k] && widthsMax[l] == widthsMax[k])
+            {
+                group.push_back(types[l]);
+                grouped[l] = true;
+            }
+        }
+        if (_verbose)
+        {
+            std::cout << "BIMF-" << level << ": widths of " << widthsMin[k] << " and " << widthsMax[k]
+                << " shared by " << group.size() << " types." << std::endl;
+        }
+        count += sweepBranch(group, node.signal, level, widthsMin[k], widthsMax[k], results, pending);
+    }
+
+    return count;
+}
+
+/**
+ * @brief Sift one BEMC of the sweep with given widths, add it to the results of a group of types,
+ * then leave the remaining signal of this group to decompose.
+ * @param types Types sharing this BEMC
+ * @param signal Remaining signal S_i, whose extremas are known to be at least 3
+ * @param level Index i of the BEMC computed
+ * @param windowWidthMin Width of the order statistics filter of the lower envelope
+ * @param windowWidthMax Width of the order statistics filter of the upper envelope
+ * @param results Lists of images of every type
+ * @param pending Nodes left to decompose, to which the remaining signal is added
+ * @return Number of BEMCs computed.
+ */
+unsigned int FABEMD::sweepBranch(const std::vector<OSFW> & types, const CImg<float> & signal, unsigned int level,
+    unsigned int windowWidthMin, unsigned int windowWidthMax, std::vector<CImgList<float> > & results,
+    std::vector<SweepNode> & pending)
+{
+    CImg<float> & residue = workspace().residue();
+    CImg<float> & bimf = workspace().bimf();
+
+    bimf = signal;
+    residue.fill(0.0f);
+    _windowWidthMin = windowWidthMin;
+    _windowWidthMax = windowWidthMax;
+
+    unsigned int j = 1;
+    do
+    {
+        if (j > 1)
+        {
+            countExtremas(3);
+            if (extremaCount() < 3)
+            {
+                return 0;
+            }
+        }
+        computeEnvelopes();
+        smoothEnvelopes();
+        _variance = subtractAverageEnvelope();
+        ++j;
+    } while (_variance > _threshold && j <= _maximumAllowableIterations);
+
+    for (unsigned int k = 0; k < types.size(); ++k)
+    {
+        results[types[k]].insert(bimf);
+    }
+    if (limitReached(level))
+    {
+        for (unsigned int k = 0; k < types.size(); ++k)
+        {
+            results[types[k]].insert(residue);
+        }
+        return 1;
+    }
+
+    // The workspace is reused by the next levels, so the remaining signal is kept apart
+    pending.push_back(SweepNode());
+    pending.back().types = types;
+    pending.back().signal = residue;
+    pending.back().level = level + 1;
+    return 1;
+}
+
+/**
+ * @brief Decompose the image with each of the 8 order statistics filter widths types at once.
+ * Types only differ by the widths they derive from the same nearest extrema distances, so that the
+ * extrema maps and distances of each level are computed once, and types whose widths agree share
+ * the sifting of the level. The decompositions form a tree, whose branches split where types first
+ * resolve to different widths. The tree is walked depth first with an explicit stack of the nodes
+ * left to decompose, so that the call depth does not grow with the number of BEMCs.
+ * @param results Resized to one list per type, indexed by OSFW, holding the images execute() would
+ * compute with this type: the original image, every computed BEMC, then the residue when a limit
+ * is reached
+ * @return Number of BEMCs computed, against the sum of the BEMC counts of every type without sharing.
+ */
+unsigned int FABEMD::sweep(std::vector<CImgList<float> > & results)
+{
+    std::vector<OSFW> types;
+    results.resize(DIFFERENT_TYPE_4 + 1);
+    for (unsigned int type = SAME_TYPE_1; type <= DIFFERENT_TYPE_4; ++type)
+    {
+        results[type].assign(1, _input);
+        types.push_back((OSFW)type);
+    }
+
+    prepareWorkspace();
+    if (_energyThreshold > 0.0f)
+    {
+        _inputMean = _input.mean();
+        _inputEnergy = energy(_input, _inputMean);
+    }
+
+    std::vector<SweepNode> pending(1);
+    pending.back().types = types;
+    pending.back().signal = _input;
+    pending.back().level = 1;
+
+    unsigned int count = 0;
+    SweepNode node;
+    while (!pending.empty())
+    {
+        node.types.swap(pending.back().types);
+        node.signal.swap(pending.back().signal);
+        node.level = pending.back().level;
+        pending.pop_back();
+        count += sweepLevel(node, results, pending);
+    }
+    return count;
+}
+
+/**
+ * @brief Execute computation of BEMC and residue.
+ * Images are computed into a list, then stacked once at the end.
+ * @return Image composed of the following slices (channels for a volume) :
+ * - The original image
+ * - Every computed BEMC
+ * - The residue, when a limit is reached
+ */
+CImg<float> FABEMD::execute()
+{
+    CImgList<float> images;
+    execute(images);
+
+    return images.get_append(_depth > 1 ? 'c' : 'z');
+}
+
+/**
+ * @brief Execute computation of BEMC and residue into a list of separately owned images.
+ * Images already in the list are reused, so that a list kept between decompositions of images of
+ * the same size is not reallocated.
+ * @param images List resized to the original image, then every computed BEMC, then the residue when
+ * a limit is reached
+ * @return Number of images in the list.
+ */
+unsigned int FABEMD::execute(CImgList<float> & images)
+{
+    ListOutput output(images);
+    unsigned int count = execute(output);
+
+    if (count < images.size())
+    {
+        images.remove(count, images.size() - 1);
+    }
+
+    return count;
+}
+
+/**
+ * @brief Execute computation of BEMC and residue into the slices of a preallocated stack.
+ * Slices are written in the same order as in the image returned by execute(), and the
+ * decomposition stops when every slice is written. Slices [0, count) can then be viewed in
+ * place with stack.get_shared_slices(0, count - 1). Volumes are stacked along the channels
+ * instead, and viewed with stack.get_shared_channels(0, count - 1).
+ * @param stack Stack of images of the size of the original image, reallocated if the sizes differ
+ * @return Number of slices (channels) written.
+ */
+unsigned int FABEMD::execute(CImg<float> & stack)
+{
+    if (_depth > 1)
+    {
+        if ((unsigned int)stack.width() != _width || (unsigned int)stack.height() != _height ||
+            (unsigned int)stack.depth() != _depth)
+        {
+            stack.assign(_width, _height, _depth, std::max(stack.spectrum(), 1));
+        }
+    }
+    else if ((unsigned int)stack.width() != _width || (unsigned int)stack.height() != _height || stack.spectrum() != 1)
+    {
+        stack.assign(_width, _height, std::max(stack.depth(), 1));
+    }
+
+    StackOutput output(stack);
+    return execute(output);
 }
@@ -8,6 +8,8 @@
 
 #include "CImg.h"
 #include "Extrema.h"
+#include "ThreadPool.h"
+#include "Workspace.h"
 
 enum OSFW
 {
@@ -21,37 +23,97 @@ enum OSFW
     DIFFERENT_TYPE_4 = 0x07
 };
 
+enum DistanceBackend
+{
+    DISTANCE_GRID = 0x00,
+    DISTANCE_TRANSFORM = 0x01
+};
+
 class FABEMD
 {
+public:
+    struct Parameters
+    {
+        OSFW osfwType;
+        unsigned int maximumAllowableIterations;
+        unsigned int size;
+        float threshold;
+        DistanceBackend distanceBackend;
+        unsigned int maximumBimfCount;
+        float energyThreshold;
+
+        Parameters();
+    };
+
+    class Output
+    {
+    public:
+        virtual ~Output() {}
+        virtual bool write(unsigned int index, const cimg_library::CImg<float> & image) = 0;
+    };
+
 private:
+    class ListOutput;
+    class StackOutput;
+
+    // Remaining signal of a group of types sharing the previous levels of the sweep
+    struct SweepNode
+    {
+        std::vector<OSFW> types;
+        cimg_library::CImg<float> signal;
+        unsigned int level;
+    };
+
     unsigned int _width;
     unsigned int _height;
+    unsigned int _depth;
     unsigned int _size;
     float _variance;
     float _threshold;
     unsigned int _maximumAllowableIterations;
     OSFW _osfwType;
+    DistanceBackend _distanceBackend;
     unsigned int _windowWidthMax;
     unsigned int _windowWidthMin;
+    unsigned int _extremaCount;
+    ThreadPool * _threadPool;
+    unsigned int _maximumBimfCount;
+    float _energyThreshold;
+    double _inputMean;
+    double _inputEnergy;
+    bool _verbose;
+    bool _residueKept;
 
     cimg_library::CImg<float> _input;
-    cimg_library::CImg<float> _bimf;
-    cimg_library::CImg<float> _lowerEnvelope;
-    cimg_library::CImg<float> _upperEnvelope;
-    cimg_library::CImg<float> _averageEnvelope;
-    cimg_library::CImg<float> _lowerKernel;
-    cimg_library::CImg<float> _upperKernel;
 
-    std::vector<Extrema> _localMinimas;
-    std::vector<Extrema> _localMaximas;
+    Workspace _ownWorkspace;
+    Workspace * _workspace;
 
+    void initialize(const cimg_library::CImg<float> & input, const Parameters & parameters);
+    Workspace & workspace();
+    void prepareWorkspace();
+    DistanceBackend distanceBackend() const;
+    unsigned int largestDimension() const { return std::max(std::max(this->_width, this->_height), this->_depth); }
     void buildExtremasMaps();
+    void countExtremas(unsigned int limit);
     void assignNearests(std::vector<Extrema> & extremas);
-    float standardDeviation();
+    float minimumNearestDistance(std::vector<Extrema> & extremas);
+    float maximumNearestDistance(std::vector<Extrema> & extremas);
+    void nearestDistances(std::vector<Extrema> & extremas, float & minimum, float & maximum);
+    float subtractAverageEnvelope();
+    static double energy(const cimg_library::CImg<float> & image, double mean);
+    bool limitReached(unsigned int bimfCount);
     unsigned int extremaCount();
     void computeFiltersWidths();
     void computeLowerEnvelope();
     void computeUpperEnvelope();
+    void computeEnvelopes();
+    void smoothEnvelopes();
+    unsigned int sweepLevel(const SweepNode & node, std::vector<cimg_library::CImgList<float> > & results,
+        std::vector<SweepNode> & pending);
+    unsigned int sweepBranch(const std::vector<OSFW> & types, const cimg_library::CImg<float> & signal,
+        unsigned int level, unsigned int windowWidthMin, unsigned int windowWidthMax,
+        std::vector<cimg_library::CImgList<float> > & results, std::vector<SweepNode> & pending);
 
 public:
     FABEMD(const cimg_library::CImg<float> & input, 
@@ -59,7 +121,24 @@ public:
         unsigned int maximumAllowableIterations = 1, 
         unsigned int size = 3, 
         float threshold = 0.05);
+    FABEMD(const cimg_library::CImg<float> & input, const Parameters & parameters);
+    void setInput(const cimg_library::CImg<float> & input);
+    void setDistanceBackend(DistanceBackend distanceBackend);
+    void setThreadPool(ThreadPool * threadPool);
+    void setWorkspace(Workspace * workspace);
+    void setMaximumBimfCount(unsigned int maximumBimfCount);
+    void setEnergyThreshold(float energyThreshold);
+    void setVerbose(bool verbose);
+    bool residueKept() const { return this->_residueKept; }
+    static bool nearestDistanceStatistics(OSFW osfwType, bool & largestMinima, bool & largestMaxima);
+    static void filtersWidths(OSFW osfwType, float minimaDistance, float maximaDistance, unsigned int largestDimension,
+        unsigned int & windowWidthMin, unsigned int & windowWidthMax);
+    unsigned int firstFiltersWidths(unsigned int & windowWidthMin, unsigned int & windowWidthMax);
+    unsigned int execute(Output & output);
     cimg_library::CImg<float> execute();
+    unsigned int execute(cimg_library::CImgList<float> & images);
+    unsigned int execute(cimg_library::CImg<float> & stack);
+    unsigned int sweep(std::vector<cimg_library::CImgList<float> > & results);
 };
 
 #endif // __FABEMD_H__
@@ -0,0 +1,102 @@
+#include "FABEMDPlan.h"
+
+using namespace cimg_library;
+
+/**
+ * @brief Plan the decompositions of images of given size with given parameters, as a stream of
+ * frames of a camera.
+ * The plan owns the images, extrema maps and filter line buffers of the decomposition, allocated
+ * here once. The nearest extrema search method is the one of the parameters, except that volumes
+ * always use the grid, which is fixed here as it only depends on the depth. The buffers of the
+ * nearest extrema searches and of the extrema detection bands grow during the first runs only, so
+ * that running the plan on further images does not allocate. A plan is not shared: threads
+ * decomposing concurrently each run their own plan.
+ * @param width Width of the images
+ * @param height Height of the images
+ * @param parameters Parameters of every decomposition
+ * @param depth Depth of the images, 1 for 2D images
+ */
+FABEMDPlan::FABEMDPlan(unsigned int width, unsigned int height, const FABEMD::Parameters & parameters,
+    unsigned int depth)
+    : _fabemd(CImg<float>(width, height, depth, 1, 0.0f), parameters)
+{
+    _width = width;
+    _height = height;
+    _depth = depth;
+    _parameters = parameters;
+    if (depth > 1)
+    {
+        _parameters.distanceBackend = DISTANCE_GRID;
+    }
+
+    _workspace.reserve(width, height, depth);
+    _workspace.detector().setSize(parameters.size);
+    _fabemd.setDistanceBackend(_parameters.distanceBackend);
+    _fabemd.setWorkspace(&_workspace);
+    _fabemd.setVerbose(false);
+}
+
+/**
+ * @brief Tell whether given image can be decomposed by this plan.
+ * @param input Source image
+ * @return True if the image has the size of the plan, whatever its number of channels.
+ */
+bool FABEMDPlan::accepts(const CImg<float> & input) const
+{
+    return (unsigned int)input.width() == _width && (unsigned int)input.height() == _height &&
+        (unsigned int)input.depth() == _depth;
+}
+
+/**
+ * @brief Throw if given image does not have the size of the plan.
+ * @param input Source image
+ */
+void FABEMDPlan::checkSize(const CImg<float> & input) const
+{
+    if (!accepts(input))
+    {
+        throw CImgArgumentException("FABEMDPlan: image of size %dx%dx%d given to a plan of size %ux%ux%u.",
+            input.width(), input.height(), input.depth(), _width, _height, _depth);
+    }
+}
+
+/**
+ * @brief Share a pool of workers with the decompositions of the plan.
+ * Without a pool (the default), the plan runs on the calling thread only. The line buffers of the
+ * filters are allocated here for each worker, so that runs on this pool do not allocate once the
+ * first runs are over either.
+ * @param threadPool Pool of workers, which must outlive the plan, or 0
+ */
+void FABEMDPlan::setThreadPool(ThreadPool * threadPool)
+{
+    _fabemd.setThreadPool(threadPool);
+}
+
+/**
+ * @brief Decompose given image into a list of images, as FABEMD::execute(CImgList<float> &).
+ * A list kept between runs is reused, so that it is not reallocated.
+ * @param input Source image, of the size of the plan, whose first channel is decomposed
+ * @param images List resized to the original image, then every computed BEMC, then the residue when
+ * a limit is reached, as residueKept() tells
+ * @return Number of images in the list.
+ */
+unsigned int FABEMDPlan::execute(const CImg<float> & input, CImgList<float> & images)
+{
+    checkSize(input);
+    _fabemd.setInput(input);
+    return _fabemd.execute(images);
+}
+
+/**
+ * @brief Decompose given image into the slices of a preallocated stack, as
+ * FABEMD::execute(CImg<float> &).
+ * @param input Source image, of the size of the plan, whose first channel is decomposed
+ * @param stack Stack of images of the size of the plan, reallocated if the sizes differ
+ * @return Number of slices (channels for a volume) written.
+ */
+unsigned int FABEMDPlan::execute(const CImg<float> & input, CImg<float> & stack)
+{
+    checkSize(input);
+    _fabemd.setInput(input);
+    return _fabemd.execute(stack);
+}
@@ -0,0 +1,42 @@
+#ifndef __FABEMD_PLAN_H__
+#define __FABEMD_PLAN_H__
+
+#include "CImg.h"
+#include "FABEMD.h"
+#include "ThreadPool.h"
+#include "Workspace.h"
+
+class FABEMDPlan
+{
+private:
+    unsigned int _width;
+    unsigned int _height;
+    unsigned int _depth;
+    FABEMD::Parameters _parameters;
+
+    Workspace _workspace;
+    FABEMD _fabemd;
+
+    void checkSize(const cimg_library::CImg<float> & input) const;
+
+    FABEMDPlan(const FABEMDPlan &);
+    FABEMDPlan & operator=(const FABEMDPlan &);
+
+public:
+    FABEMDPlan(unsigned int width, unsigned int height, const FABEMD::Parameters & parameters,
+        unsigned int depth = 1);
+
+    unsigned int width() const { return this->_width; }
+    unsigned int height() const { return this->_height; }
+    unsigned int depth() const { return this->_depth; }
+    const FABEMD::Parameters & parameters() const { return this->_parameters; }
+
+    bool residueKept() const { return this->_fabemd.residueKept(); }
+
+    bool accepts(const cimg_library::CImg<float> & input) const;
+    void setThreadPool(ThreadPool * threadPool);
+    unsigned int execute(const cimg_library::CImg<float> & input, cimg_library::CImgList<float> & images);
+    unsigned int execute(const cimg_library::CImg<float> & input, cimg_library::CImg<float> & stack);
+};
+
+#endif // __FABEMD_PLAN_H__
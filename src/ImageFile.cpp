@@ -0,0 +1,394 @@
+#include "ImageFile.h"
+
+using namespace cimg_library;
+
+/**
+ * @brief Create a closed image file.
+ */
+ImageFile::ImageFile()
+{
+    _file = 0;
+    _width = 0;
+    _height = 0;
+    _pixelType = PIXEL_FLOAT;
+    _pixelSize = sizeof(float);
+    _swapped = false;
+    _dataOffset = 0;
+}
+
+/**
+ * @brief Close the file.
+ */
+ImageFile::~ImageFile()
+{
+    close();
+}
+
+/**
+ * @brief Move to a pixel.
+ * Offsets are 64-bit, so that pixels of files larger than 4 GB can be reached.
+ * @param column Column of the pixel
+ * @param row Row of the pixel
+ */
+void ImageFile::seek(unsigned int column, unsigned int row)
+{
+    Offset offset = _dataOffset + ((Offset)row * _width + column) * _pixelSize;
+#ifdef _WIN32
+    int error = _fseeki64(_file, offset, SEEK_SET);
+#else
+    int error = fseeko(_file, offset, SEEK_SET);
+#endif
+    if (error)
+    {
+        throw CImgIOException("ImageFile: cannot seek pixel (%u,%u) of file '%s'.", column, row, _filename.c_str());
+    }
+}
+
+/**
+ * @brief Convert the raw pixels read into the raw buffer to floats.
+ * @param pixels Destination of the converted pixels
+ * @param count Number of pixels
+ */
+template<typename T>
+void ImageFile::convert(float * pixels, size_t count)
+{
+    T * raw = reinterpret_cast<T *>(&_raw[0]);
+    if (_swapped)
+    {
+        cimg::invert_endianness(raw, count);
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        pixels[i] = (float)raw[i];
+    }
+}
+
+/**
+ * @brief Read consecutive pixels from the current position, converted to floats.
+ * @param pixels Destination of the pixels
+ * @param count Number of pixels
+ * @return False if the file is too short.
+ */
+bool ImageFile::read(float * pixels, size_t count)
+{
+    if (_pixelType == PIXEL_FLOAT)
+    {
+        if (std::fread(pixels, sizeof(float), count, _file) != count)
+        {
+            return false;
+        }
+        if (_swapped)
+        {
+            cimg::invert_endianness(pixels, count);
+        }
+        return true;
+    }
+
+    _raw.resize(count * _pixelSize);
+    if (std::fread(&_raw[0], _pixelSize, count, _file) != count)
+    {
+        return false;
+    }
+    switch (_pixelType)
+    {
+    case PIXEL_UNSIGNED_CHAR:
+        convert<unsigned char>(pixels, count);
+        break;
+    case PIXEL_UNSIGNED_SHORT:
+        convert<unsigned short>(pixels, count);
+        break;
+    case PIXEL_SHORT:
+        convert<short>(pixels, count);
+        break;
+    case PIXEL_DOUBLE:
+    default:
+        convert<double>(pixels, count);
+        break;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Write consecutive pixels of a native float file from the current position.
+ * @param pixels Source of the pixels
+ * @param count Number of pixels
+ * @return False if the pixels cannot be written.
+ */
+bool ImageFile::write(const float * pixels, size_t count)
+{
+    if (_pixelType != PIXEL_FLOAT || _swapped)
+    {
+        throw CImgIOException("ImageFile: file '%s' is not a native float file.", _filename.c_str());
+    }
+
+    return std::fwrite(pixels, sizeof(float), count, _file) == count;
+}
+
+/**
+ * @brief Open an existing .cimg file for reading, without reading its pixels.
+ * Only uncompressed 2D images are supported. Pixels may be stored as unsigned char, unsigned short,
+ * short, float or double, and are converted to floats when read. Only the first image of the file,
+ * and its first channel, are read.
+ * @param filename Path of the file
+ */
+void ImageFile::open(const char * filename)
+{
+    close();
+    _filename = filename;
+    _file = std::fopen(filename, "rb");
+    if (!_file)
+    {
+        throw CImgIOException("ImageFile: cannot open file '%s'.", filename);
+    }
+
+    char line[256] = { 0 };
+    char pixelType[256] = { 0 };
+    char endianness[256] = { 0 };
+    unsigned int count = 0;
+    unsigned int depth = 0;
+    unsigned int spectrum = 0;
+    int fields = 0;
+
+    if (std::fgets(line, sizeof(line), _file))
+    {
+        fields = std::sscanf(line, "%u %255[A-Za-z_] %255[A-Za-z_]", &count, pixelType, endianness);
+    }
+    if (fields < 2 || !count)
+    {
+        throw CImgIOException("ImageFile: no CImg header in file '%s'.", filename);
+    }
+
+    bool bigEndian = cimg::endianness();
+    if (!cimg::strncasecmp("little", endianness, 6))
+    {
+        bigEndian = false;
+    }
+    else if (!cimg::strncasecmp("big", endianness, 3))
+    {
+        bigEndian = true;
+    }
+    _swapped = bigEndian != cimg::endianness();
+
+    if (!cimg::strcasecmp(pixelType, "unsigned_char") || !cimg::strcasecmp(pixelType, "uchar"))
+    {
+        _pixelType = PIXEL_UNSIGNED_CHAR;
+        _pixelSize = sizeof(unsigned char);
+    }
+    else if (!cimg::strcasecmp(pixelType, "unsigned_short") || !cimg::strcasecmp(pixelType, "ushort"))
+    {
+        _pixelType = PIXEL_UNSIGNED_SHORT;
+        _pixelSize = sizeof(unsigned short);
+    }
+    else if (!cimg::strcasecmp(pixelType, "short"))
+    {
+        _pixelType = PIXEL_SHORT;
+        _pixelSize = sizeof(short);
+    }
+    else if (!cimg::strcasecmp(pixelType, "float"))
+    {
+        _pixelType = PIXEL_FLOAT;
+        _pixelSize = sizeof(float);
+    }
+    else if (!cimg::strcasecmp(pixelType, "double"))
+    {
+        _pixelType = PIXEL_DOUBLE;
+        _pixelSize = sizeof(double);
+    }
+    else
+    {
+        throw CImgIOException("ImageFile: unsupported pixel type '%s' in file '%s'.", pixelType, filename);
+    }
+
+    char compressed = 0;
+    fields = 0;
+    if (std::fgets(line, sizeof(line), _file))
+    {
+        fields = std::sscanf(line, "%u %u %u %u %c", &_width, &_height, &depth, &spectrum, &compressed);
+    }
+    if (fields < 4 || !_width || !_height || !depth || !spectrum)
+    {
+        throw CImgIOException("ImageFile: invalid image size in file '%s'.", filename);
+    }
+    if (fields == 5 && compressed == '#')
+    {
+        throw CImgIOException("ImageFile: compressed file '%s' cannot be read by rows.", filename);
+    }
+    if (depth > 1)
+    {
+        throw CImgIOException("ImageFile: file '%s' holds a volume, only 2D images can be read by rows.", filename);
+    }
+
+#ifdef _WIN32
+    _dataOffset = _ftelli64(_file);
+#else
+    _dataOffset = ftello(_file);
+#endif
+}
+
+/**
+ * @brief Create a float .cimg file of given size, whose pixels are all zero.
+ * The pixels are not written, so that the file is sparse where the file system allows it.
+ * @param filename Path of the file, replaced if it exists
+ * @param width Image width
+ * @param height Image height
+ */
+void ImageFile::create(const char * filename, unsigned int width, unsigned int height)
+{
+    close();
+    _filename = filename;
+    _file = std::fopen(filename, "w+b");
+    if (!_file)
+    {
+        throw CImgIOException("ImageFile: cannot create file '%s'.", filename);
+    }
+
+    _width = width;
+    _height = height;
+    _pixelType = PIXEL_FLOAT;
+    _pixelSize = sizeof(float);
+    _swapped = false;
+
+    std::fprintf(_file, "1 float %s_endian\n%u %u 1 1\n", cimg::endianness() ? "big" : "little", width, height);
+#ifdef _WIN32
+    _dataOffset = _ftelli64(_file);
+#else
+    _dataOffset = ftello(_file);
+#endif
+
+    // Writing the last byte sets the file size
+    seek(0, height);
+    std::fseek(_file, -1, SEEK_CUR);
+    if (std::fputc(0, _file) == EOF)
+    {
+        throw CImgIOException("ImageFile: cannot write file '%s'.", filename);
+    }
+}
+
+/**
+ * @brief Close the file, if open.
+ */
+void ImageFile::close()
+{
+    if (_file)
+    {
+        std::fclose(_file);
+        _file = 0;
+    }
+}
+
+/**
+ * @brief Close the file and move it to another path.
+ * @param filename New path of the file, replaced if it exists
+ */
+void ImageFile::rename(const char * filename)
+{
+    close();
+    std::remove(filename);
+    if (std::rename(_filename.c_str(), filename))
+    {
+        throw CImgIOException("ImageFile: cannot rename file '%s' to '%s'.", _filename.c_str(), filename);
+    }
+    _filename = filename;
+}
+
+/**
+ * @brief Close the file and delete it.
+ */
+void ImageFile::remove()
+{
+    close();
+    if (!_filename.empty())
+    {
+        std::remove(_filename.c_str());
+    }
+}
+
+/**
+ * @brief Read consecutive rows, converted to floats.
+ * @param firstRow First row read
+ * @param rowCount Number of rows read
+ * @param rows Destination of width * rowCount pixels
+ */
+void ImageFile::readRows(unsigned int firstRow, unsigned int rowCount, float * rows)
+{
+    seek(0, firstRow);
+    if (!read(rows, (size_t)_width * rowCount))
+    {
+        throw CImgIOException("ImageFile: cannot read rows %u to %u of file '%s'.",
+            firstRow, firstRow + rowCount - 1, _filename.c_str());
+    }
+}
+
+/**
+ * @brief Write consecutive rows of a float file.
+ * @param firstRow First row written
+ * @param rowCount Number of rows written
+ * @param rows Source of width * rowCount pixels
+ */
+void ImageFile::writeRows(unsigned int firstRow, unsigned int rowCount, const float * rows)
+{
+    seek(0, firstRow);
+    if (!write(rows, (size_t)_width * rowCount))
+    {
+        throw CImgIOException("ImageFile: cannot write rows %u to %u of file '%s'.",
+            firstRow, firstRow + rowCount - 1, _filename.c_str());
+    }
+}
+
+/**
+ * @brief Read a rectangular block of pixels, converted to floats, row after row.
+ * A block of whole rows is read at once.
+ * @param left First column read
+ * @param top First row read
+ * @param width Number of columns read
+ * @param height Number of rows read
+ * @param block Destination of width * height pixels, in row-major order
+ */
+void ImageFile::readBlock(unsigned int left, unsigned int top, unsigned int width, unsigned int height,
+    float * block)
+{
+    if (left == 0 && width == _width)
+    {
+        readRows(top, height, block);
+        return;
+    }
+
+    for (unsigned int y = 0; y < height; ++y)
+    {
+        seek(left, top + y);
+        if (!read(block + (size_t)y * width, width))
+        {
+            throw CImgIOException("ImageFile: cannot read pixels (%u,%u) to (%u,%u) of file '%s'.",
+                left, top + y, left + width - 1, top + y, _filename.c_str());
+        }
+    }
+}
+
+/**
+ * @brief Write a rectangular block of pixels of a float file, row after row.
+ * @param left First column written
+ * @param top First row written
+ * @param width Number of columns written
+ * @param height Number of rows written
+ * @param block Source of width * height pixels, in row-major order
+ */
+void ImageFile::writeBlock(unsigned int left, unsigned int top, unsigned int width, unsigned int height,
+    const float * block)
+{
+    if (left == 0 && width == _width)
+    {
+        writeRows(top, height, block);
+        return;
+    }
+
+    for (unsigned int y = 0; y < height; ++y)
+    {
+        seek(left, top + y);
+        if (!write(block + (size_t)y * width, width))
+        {
+            throw CImgIOException("ImageFile: cannot write pixels (%u,%u) to (%u,%u) of file '%s'.",
+                left, top + y, left + width - 1, top + y, _filename.c_str());
+        }
+    }
+}
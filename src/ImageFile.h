@@ -0,0 +1,74 @@
+#ifndef __IMAGE_FILE_H__
+#define __IMAGE_FILE_H__
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#endif
+
+#include "CImg.h"
+
+class ImageFile
+{
+public:
+#ifdef _WIN32
+    typedef __int64 Offset;
+#else
+    typedef off_t Offset;
+#endif
+
+private:
+    enum PixelType
+    {
+        PIXEL_UNSIGNED_CHAR,
+        PIXEL_UNSIGNED_SHORT,
+        PIXEL_SHORT,
+        PIXEL_FLOAT,
+        PIXEL_DOUBLE
+    };
+
+    std::FILE * _file;
+    std::string _filename;
+    unsigned int _width;
+    unsigned int _height;
+    PixelType _pixelType;
+    unsigned int _pixelSize;
+    bool _swapped;
+    Offset _dataOffset;
+    std::vector<char> _raw;
+
+    void seek(unsigned int column, unsigned int row);
+    template<typename T>
+    void convert(float * pixels, size_t count);
+    bool read(float * pixels, size_t count);
+    bool write(const float * pixels, size_t count);
+
+    ImageFile(const ImageFile &);
+    ImageFile & operator=(const ImageFile &);
+
+public:
+    ImageFile();
+    ~ImageFile();
+
+    void open(const char * filename);
+    void create(const char * filename, unsigned int width, unsigned int height);
+    void close();
+    void rename(const char * filename);
+    void remove();
+
+    const std::string & filename() const { return this->_filename; }
+    unsigned int width() const { return this->_width; }
+    unsigned int height() const { return this->_height; }
+
+    void readRows(unsigned int firstRow, unsigned int rowCount, float * rows);
+    void writeRows(unsigned int firstRow, unsigned int rowCount, const float * rows);
+    void readBlock(unsigned int left, unsigned int top, unsigned int width, unsigned int height, float * block);
+    void writeBlock(unsigned int left, unsigned int top, unsigned int width, unsigned int height,
+        const float * block);
+};
+
+#endif // __IMAGE_FILE_H__
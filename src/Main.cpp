@@ -1,10 +1,29 @@
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <vector>
 #include <sstream>
+#include <string>
+#include <utility>
 
+#ifdef _WIN32
+#include <direct.h>
+#include <windows.h>
+#else
+#include <glob.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#include "AllocationCounter.h"
+#include "Batch.h"
 #include "CImg.h"
 #include "FABEMD.h"
+#include "ImageFile.h"
+#include "MultichannelFABEMD.h"
+#include "StreamingFABEMD.h"
+#include "Thread.h"
+#include "TiledFABEMD.h"
 
 using namespace cimg_library;
 using namespace std;
@@ -121,6 +140,346 @@ CImg<float> generateSynthetic(unsigned int count, unsigned int width, unsigned i
     return result;
 }
 
+// Decomposition run in the background, publishing each image to the viewer as soon as it is computed
+class ProgressiveDecomposition : public FABEMD::Output, public ThreadPool::Task
+{
+private:
+    FABEMD & _fabemd;
+    Mutex _mutex;
+    CImgList<unsigned char> _slices;
+    bool _done;
+    bool _cancelled;
+
+public:
+    ProgressiveDecomposition(FABEMD & fabemd) : _fabemd(fabemd), _done(false), _cancelled(false) {}
+
+    // Slices are normalised once, as the display would do on each redraw
+    bool write(unsigned int, const CImg<float> & image)
+    {
+        CImg<unsigned char> slice = image.get_normalize(0, 255);
+        _mutex.lock();
+        _slices.insert(slice);
+        bool cancelled = _cancelled;
+        _mutex.unlock();
+        return !cancelled;
+    }
+
+    void run(unsigned int, unsigned int)
+    {
+        _fabemd.execute(*this);
+        _mutex.lock();
+        _done = true;
+        _mutex.unlock();
+    }
+
+    // Stop the decomposition once the current BEMC is computed
+    void cancel()
+    {
+        _mutex.lock();
+        _cancelled = true;
+        _mutex.unlock();
+    }
+
+    // Get the number of slices available and whether the decomposition is over
+    unsigned int progress(bool & done)
+    {
+        _mutex.lock();
+        unsigned int count = _slices.size();
+        done = _done;
+        _mutex.unlock();
+        return count;
+    }
+
+    void display(CImgDisplay & frame, unsigned int z)
+    {
+        _mutex.lock();
+        frame.display(_slices[z]);
+        _mutex.unlock();
+    }
+};
+
+// Expand comma separated glob patterns into the sorted list of matching files
+vector<string> expandPatterns(const string & patterns)
+{
+    vector<string> files;
+    istringstream patternStream(patterns);
+    string pattern;
+
+    while (getline(patternStream, pattern, ','))
+    {
+        vector<string> matches;
+#ifdef _WIN32
+        string directory = pattern.substr(0, pattern.find_last_of("/\\") + 1);
+        WIN32_FIND_DATAA data;
+        HANDLE handle = FindFirstFileA(pattern.c_str(), &data);
+        if (handle != INVALID_HANDLE_VALUE)
+        {
+            do
+            {
+                if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+                {
+                    matches.push_back(directory + data.cFileName);
+                }
+            } while (FindNextFileA(handle, &data));
+            FindClose(handle);
+        }
+#else
+        glob_t result;
+        if (glob(pattern.c_str(), 0, 0, &result) == 0)
+        {
+            for (size_t i = 0; i < result.gl_pathc; ++i)
+            {
+                matches.push_back(result.gl_pathv[i]);
+            }
+        }
+        globfree(&result);
+#endif
+        if (matches.empty())
+        {
+            cerr << "No file matches " << pattern << endl;
+        }
+        sort(matches.begin(), matches.end());
+        files.insert(files.end(), matches.begin(), matches.end());
+    }
+
+    return files;
+}
+
+// Get the file name without its directory and extension
+string stem(const string & path)
+{
+    string name = path.substr(path.find_last_of("/\\") + 1);
+    return name.substr(0, name.find_last_of('.'));
+}
+
+// Check that no two files share a stem, as their outputs would overwrite each other
+bool distinctStems(const vector<string> & files)
+{
+    vector<pair<string, string> > stems;
+    for (unsigned int i = 0; i < files.size(); ++i)
+    {
+        stems.push_back(make_pair(stem(files[i]), files[i]));
+    }
+    sort(stems.begin(), stems.end());
+
+    bool distinct = true;
+    for (unsigned int i = 1; i < stems.size(); ++i)
+    {
+        if (stems[i].first == stems[i - 1].first)
+        {
+            cerr << stems[i - 1].second << " and " << stems[i].second << " would write the same output files" << endl;
+            distinct = false;
+        }
+    }
+    return distinct;
+}
+
+// Create the output directory of the modes writing files, if it does not exist
+void makeOutputDirectory(const string & directory)
+{
+#ifdef _WIN32
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+}
+
+// Decompose every file matching given patterns, writing each BIMF and the residue into given directory
+int runBatch(const string & patterns, const string & directory, const string & format,
+    const FABEMD::Parameters & parameters, ThreadPool & threadPool)
+{
+    const vector<string> files = expandPatterns(patterns);
+    if (!distinctStems(files))
+    {
+        return 1;
+    }
+
+    // Images are loaded and written by chunks, a few per worker, so that memory does not grow with the batch
+    Batch batch(parameters, &threadPool);
+    const unsigned int chunkSize = 4 * threadPool.size();
+    CImgList<float> inputs;
+    vector<string> names;
+    vector<CImgList<float> > results;
+    int status = 0;
+
+    for (unsigned int first = 0; first < files.size(); first += chunkSize)
+    {
+        inputs.assign();
+        names.clear();
+        for (unsigned int i = first; i < files.size() && i < first + chunkSize; ++i)
+        {
+            try
+            {
+                inputs.insert(CImg<float>(files[i].c_str()));
+                names.push_back(stem(files[i]));
+            }
+            catch (CImgException & exception)
+            {
+                cerr << "Cannot read " << files[i] << ": " << exception.what() << endl;
+                status = 1;
+            }
+        }
+
+        batch.execute(inputs, results);
+
+        // The first image of each result is the input, the last one the residue when a limit was reached
+        for (unsigned int i = 0; i < inputs.size(); ++i)
+        {
+            for (unsigned int k = 1; k < results[i].size(); ++k)
+            {
+                ostringstream path;
+                path << directory << "/" << names[i];
+                if (k + 1 < results[i].size() || !batch.residueKept(i))
+                {
+                    path << "_bimf" << k;
+                }
+                else
+                {
+                    path << "_residue";
+                }
+                path << "." << format;
+
+                try
+                {
+                    results[i][k].save(path.str().c_str());
+                }
+                catch (CImgException & exception)
+                {
+                    cerr << "Cannot write " << path.str() << ": " << exception.what() << endl;
+                    status = 1;
+                }
+            }
+            cout << names[i] << ": " << results[i].size() - 1 << " images written." << endl;
+        }
+    }
+
+    batch.report(cout);
+    return status;
+}
+
+// Decompose a .cimg file too large for memory tile by tile, writing each BIMF and the residue into given directory
+int runTiled(const string & filename, const string & directory, unsigned int tileSize, unsigned int memoryBudget,
+    const FABEMD::Parameters & parameters, ThreadPool & threadPool)
+{
+    TiledFABEMD fabemd(filename.c_str(), parameters, tileSize, (size_t)memoryBudget << 20);
+    fabemd.setThreadPool(&threadPool);
+    unsigned int count = fabemd.execute(directory + "/" + stem(filename));
+    cout << stem(filename) << ": " << count << " images written." << endl;
+
+    return 0;
+}
+
+// Decompose every channel of an image together, writing the stack of BIMFs of each channel into given directory
+int runMultichannel(const string & filename, const string & directory, const FABEMD::Parameters & parameters,
+    ThreadPool & threadPool)
+{
+    MultichannelFABEMD fabemd(CImg<float>(filename.c_str()), parameters);
+    fabemd.setThreadPool(&threadPool);
+    CImgList<float> stacks = fabemd.execute();
+    for (unsigned int c = 0; c < stacks.size(); ++c)
+    {
+        ostringstream path;
+        path << directory << "/" << stem(filename) << "_c" << c << ".cimg";
+        stacks[c].save(path.str().c_str());
+        cout << path.str() << ": " << stacks[c].depth() - 1 << " images." << endl;
+    }
+
+    return 0;
+}
+
+// Decompose co-registered images in lockstep with shared widths, writing the stack of BIMFs of each image into given directory
+int runMultivariate(const string & patterns, const string & directory, const FABEMD::Parameters & parameters,
+    ThreadPool & threadPool)
+{
+    const vector<string> files = expandPatterns(patterns);
+    if (!distinctStems(files))
+    {
+        return 1;
+    }
+
+    CImgList<float> images;
+    for (unsigned int i = 0; i < files.size(); ++i)
+    {
+        images.insert(CImg<float>(files[i].c_str()));
+    }
+
+    MultichannelFABEMD fabemd(images, parameters);
+    fabemd.setThreadPool(&threadPool);
+    CImgList<float> stacks = fabemd.execute();
+    for (unsigned int i = 0; i < stacks.size(); ++i)
+    {
+        const string path = directory + "/" + stem(files[i]) + "_levels.cimg";
+        stacks[i].save(path.c_str());
+        cout << path << ": " << stacks[i].depth() - 1 << " images." << endl;
+    }
+
+    return 0;
+}
+
+// Decompose an image with every order statistics filter widths type, sharing the work of the types whose widths agree
+int runSweep(const string & filename, const string & directory, const FABEMD::Parameters & parameters,
+    ThreadPool & threadPool)
+{
+    FABEMD fabemd(CImg<float>(filename.c_str()), parameters);
+    fabemd.setThreadPool(&threadPool);
+    vector<CImgList<float> > results;
+    const unsigned int count = fabemd.sweep(results);
+    for (unsigned int type = 0; type < results.size(); ++type)
+    {
+        ostringstream path;
+        path << directory << "/" << stem(filename) << "_osfw" << type << ".cimg";
+        results[type].save(path.str().c_str());
+        cout << path.str() << ": " << results[type].size() - 1 << " images." << endl;
+    }
+    cout << count << " images computed for the " << results.size() << " types." << endl;
+
+    return 0;
+}
+
+// Write the rows of a streaming decomposition into the BIMF and residue files
+class FileRowOutput : public StreamingFABEMD::RowOutput
+{
+private:
+    ImageFile & _bimf;
+    ImageFile & _residue;
+
+public:
+    FileRowOutput(ImageFile & bimf, ImageFile & residue) : _bimf(bimf), _residue(residue) {}
+
+    void write(unsigned int row, const float * bimf, const float * residue)
+    {
+        _bimf.writeRows(row, 1, bimf);
+        _residue.writeRows(row, 1, residue);
+    }
+};
+
+// Decompose a .cimg file row by row into its first BIMF and residue, as an image coming from a line scanner
+int runStreaming(const string & filename, const string & directory, unsigned int windowWidth, unsigned int size)
+{
+    ImageFile input;
+    ImageFile bimf;
+    ImageFile residue;
+    const string prefix = directory + "/" + stem(filename);
+    input.open(filename.c_str());
+    bimf.create((prefix + "_bimf1.cimg").c_str(), input.width(), input.height());
+    residue.create((prefix + "_residue.cimg").c_str(), input.width(), input.height());
+
+    FileRowOutput output(bimf, residue);
+    StreamingFABEMD fabemd(input.width(), windowWidth, windowWidth, output, size);
+    vector<float> row(input.width());
+    for (unsigned int y = 0; y < input.height(); ++y)
+    {
+        input.readRows(y, 1, &row[0]);
+        fabemd.push(&row[0]);
+    }
+    fabemd.finish();
+
+    cout << stem(filename) << ": " << fabemd.extremaCount() << " extremas, latency of "
+        << fabemd.latency() << " rows, variance of " << fabemd.variance() << "." << endl;
+
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     // Retrieve informations from command line
@@ -131,6 +490,80 @@ int main(int argc, char **argv)
     const unsigned int maximumAllowableIterations = cimg_option("-n", 1, "Maximal number of BIMC - ITS for the computation of a BIMC");
     const unsigned int size = cimg_option("-w", 3, "Size of the extrema search window");
     const float threshold = (float)cimg_option("-t", 0.05f, "Maximal standard variation thredshold to get to next BIMC");
+    const DistanceBackend distanceBackend = (DistanceBackend)cimg_option("-d", 0, "Nearest extrema search method (0: DISTANCE_GRID, 1: DISTANCE_TRANSFORM)");
+    const unsigned int maximumBimfCount = cimg_option("-l", 0, "Maximal number of BIMC, the remaining signal being kept as residue (0: no limit)");
+    const float energyThreshold = (float)cimg_option("-e", 0.0f, "Fraction of the input energy under which the remaining signal is kept as residue (0: never)");
+    const unsigned int threadCount = cimg_option("-j", 0, "Number of worker threads (0: one per processor)");
+    const char* patterns = cimg_option("-b", (char*)0, "Batch mode: comma separated glob patterns of the input image files, decomposed without display");
+    const char* directory = cimg_option("-O", "output", "Batch, tiled, streaming, multichannel, multivariate and sweep modes: output directory of the BIMCs and residues");
+    const char* format = cimg_option("-f", "cimg", "Batch mode: extension giving the format of the output files");
+    const unsigned int tileSize = cimg_option("-T", 0, "Tiled mode: if different from 0, decompose the .cimg input file by square tiles of this number of rows and columns into the output directory, without display");
+    const unsigned int memoryBudget = cimg_option("-m", 1024, "Tiled mode: memory budget in MiB of the tiles, their halos and the extremas around a tile, the decomposition failing rather than exceed it");
+    const char* multivariate = cimg_option("-M", (char*)0, "Multivariate mode: comma separated glob patterns of co-registered image files, decomposed in lockstep with shared order statistics filter widths so that their BIMCs line up, writing the stack of BIMCs of each image into the output directory, without display");
+    const bool multichannel = (bool)cimg_option("-c", 0, "Multichannel mode: if different from 0, decompose every channel of the input image together, writing the stack of BIMCs of each channel into the output directory, without display");
+    const bool sweep = (bool)cimg_option("-a", 0, "Sweep mode: if different from 0, decompose the input image with all the order statistics filter widths types, sharing the work of the types whose widths agree, writing the images of each type into the output directory, without display");
+    const unsigned int streamingWidth = cimg_option("-S", 0, "Streaming mode: if different from 0, decompose the .cimg input file row by row into its first BIMC and residue, with order statistics filters of this width, into the output directory, without display");
+
+    FABEMD::Parameters parameters;
+    parameters.osfwType = osfwType;
+    parameters.maximumAllowableIterations = maximumAllowableIterations;
+    parameters.size = size;
+    parameters.threshold = threshold;
+    parameters.distanceBackend = distanceBackend;
+    parameters.maximumBimfCount = maximumBimfCount;
+    parameters.energyThreshold = energyThreshold;
+
+    // File modes exclude each other, rather than the first one silently taking precedence
+    const unsigned int modeCount = (patterns != 0) + (tileSize > 0) + (multivariate != 0) + multichannel +
+        sweep + (streamingWidth > 0);
+    if (modeCount > 1)
+    {
+        cerr << "Options -b, -T, -M, -c, -a and -S select different modes, use only one of them." << endl;
+        return 1;
+    }
+
+    ThreadPool threadPool(threadCount);
+    if (modeCount == 1)
+    {
+        // Errors of the file modes are reported once here, instead of by CImg itself
+        const string subject = patterns ? patterns : multivariate ? multivariate : filename;
+        makeOutputDirectory(directory);
+        cimg::exception_mode(0);
+        try
+        {
+            if (patterns)
+            {
+                return runBatch(patterns, directory, format, parameters, threadPool);
+            }
+            if (tileSize > 0)
+            {
+                return runTiled(filename, directory, tileSize, memoryBudget, parameters, threadPool);
+            }
+            if (multivariate)
+            {
+                return runMultivariate(multivariate, directory, parameters, threadPool);
+            }
+            if (multichannel)
+            {
+                return runMultichannel(filename, directory, parameters, threadPool);
+            }
+            if (sweep)
+            {
+                return runSweep(filename, directory, parameters, threadPool);
+            }
+            return runStreaming(filename, directory, streamingWidth, size);
+        }
+        catch (CImgException & exception)
+        {
+            cerr << "Cannot decompose " << subject << ": " << exception.what() << endl;
+            return 1;
+        }
+    }
+
+#if cimg_display == 0
+    cerr << "This build has no display, use -b to decompose images into files." << endl;
+    return 1;
+#endif
 
     // Get input image
     CImg<float> input;
@@ -144,33 +577,45 @@ int main(int argc, char **argv)
     }
 
     // Compute BEMCs
-    FABEMD fabemd(input, osfwType, maximumAllowableIterations, size, threshold);
-    CImg<float> result = fabemd.execute();
+    FABEMD fabemd(input, parameters);
+    fabemd.setThreadPool(&threadPool);
+
+    // Decompose twice, the second time with the workspace and output warmed up, and report its heap allocations,
+    // counted atomically across the workers of the pool
+    if (AllocationCounter::enabled())
+    {
+        CImgList<float> result;
+        fabemd.execute(result);
+        unsigned long allocations = AllocationCounter::count();
+        fabemd.execute(result);
+        cout << "Heap allocations once warmed up: " << AllocationCounter::count() - allocations << endl;
+    }
+
+    // The window opens at once, BEMCs being shown as soon as the background decomposition computes them
+    ProgressiveDecomposition decomposition(fabemd);
+    Thread decompositionThread;
+    decompositionThread.start(decomposition);
 
     // Create frame
     CImgDisplay frame = CImgDisplay(512, 512);
     int z = 0;
-    int wheelState = 1;
+    unsigned int count = 0;
+    bool done = false;
+    bool redraw = false;
     ostringstream titleStream;
 
     while (!frame.is_closed())
     {
-        // Process wheel events
-        if (frame.wheel() != wheelState)
+        // Look for new BEMCs, the title showing whether more are coming
+        if (!done)
         {
-            int delta = frame.wheel() - wheelState;
-            z += delta;
-            wheelState = frame.wheel();
-            // Check if required index is in bound
-            if (z < 0)
-            {
-                z = 0;
-            }
-            else if (z >= result.depth())
-            {
-                z = result.depth() - 1;
-            }
+            unsigned int available = decomposition.progress(done);
+            redraw = redraw || available != count || done;
+            count = available;
+        }
 
+        if (redraw && count > 0)
+        {
             // Change frame's title
             if (z == 0)
             {
@@ -178,7 +623,11 @@ int main(int argc, char **argv)
             }
             else
             {
-                titleStream << "BEMC " << z << "/" << result.depth() - 1;
+                titleStream << "BEMC " << z << "/" << count - 1;
+            }
+            if (!done)
+            {
+                titleStream << " (computing)";
             }
 
             frame.set_title(titleStream.str().c_str());
@@ -186,9 +635,48 @@ int main(int argc, char **argv)
             titleStream.str(std::string());
 
             // Display required image
-            frame.display(result.get_slice(z));
+            decomposition.display(frame, z);
+            redraw = false;
+        }
+
+        // Sleep until the next event, or poll for new BEMCs while the decomposition runs
+        if (done)
+        {
+            frame.wait();
+        }
+        else
+        {
+            cimg::wait(50);
+        }
+
+        // Process wheel events
+        if (frame.wheel())
+        {
+            int previous = z;
+            z += frame.wheel();
+            frame.set_wheel();
+            // Check if required index is in bound
+            if (z < 0)
+            {
+                z = 0;
+            }
+            else if (z >= (int)count)
+            {
+                z = count > 0 ? (int)count - 1 : 0;
+            }
+            redraw = z != previous;
+        }
+
+        // Process resize events
+        if (frame.is_resized())
+        {
+            frame.resize(false);
+            redraw = true;
         }
     }
 
+    decomposition.cancel();
+    decompositionThread.join();
+
     return 0;
 }
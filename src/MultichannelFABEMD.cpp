@@ -0,0 +1,487 @@
+#include "MultichannelFABEMD.h"
+
+using namespace cimg_library;
+
+/**
+ * @brief Prepare the decomposition of every channel of a 2D image, sifted together.
+ * Channels are stored interleaved, the channels of a pixel being contiguous, so that each pass over
+ * the image handles every channel: a vector of the extrema detection covers every channel of a few
+ * pixels, the envelope filters handle the channels of a pixel together when they share widths, and
+ * the mean envelopes of all channels are subtracted in a single pass. Each channel
+ * keeps its own extrema maps, filters widths and stop criteria, so that its BEMCs are those FABEMD
+ * computes from this channel alone, unless widths are shared (see setSharedWidths()).
+ * @param input Source image, of any number of channels
+ * @param parameters Parameters of the decomposition of each channel
+ */
+MultichannelFABEMD::MultichannelFABEMD(const CImg<float> & input, const FABEMD::Parameters & parameters)
+    : _parameters(parameters)
+{
+    initialize(input);
+}
+
+/**
+ * @brief Prepare the multivariate decomposition of co-registered images, such as visible and
+ * infrared images of a scene, in lockstep with shared widths so that their BEMCs line up.
+ * The first channel of each image becomes a channel of the decomposition.
+ * @param images Source images, all of the same size
+ * @param parameters Parameters of the decomposition
+ */
+MultichannelFABEMD::MultichannelFABEMD(const CImgList<float> & images, const FABEMD::Parameters & parameters)
+    : _parameters(parameters)
+{
+    CImg<float> input;
+    for (unsigned int i = 0; i < images.size(); ++i)
+    {
+        if (images[i].width() != images[0].width() || images[i].height() != images[0].height() ||
+            images[i].depth() != images[0].depth())
+        {
+            throw CImgArgumentException("MultichannelFABEMD: image %u is not of the size of the first image.", i);
+        }
+        input.append(images[i].get_shared_channel(0), 'c');
+    }
+    initialize(input);
+    _sharedWidths = true;
+}
+
+/**
+ * @brief Set up the decomposition of the channels of given image.
+ * @param input Source image, of any number of channels
+ */
+void MultichannelFABEMD::initialize(const CImg<float> & input)
+{
+    if (input.depth() > 1)
+    {
+        throw CImgArgumentException("MultichannelFABEMD: volumes are not supported, only 2D images.");
+    }
+
+    _width = (unsigned int)input.width();
+    _height = (unsigned int)input.height();
+    _channels = (unsigned int)input.spectrum();
+    _sharedWidths = false;
+    _threadPool = 0;
+    _verbose = true;
+
+    _windowWidthsMin.assign(_channels, 3);
+    _windowWidthsMax.assign(_channels, 3);
+    _extremaCounts.assign(_channels, 0);
+    _variances.assign(_channels, 0.0f);
+    _inputMeans.assign(_channels, 0.0);
+    _inputEnergies.assign(_channels, 0.0);
+    _activeWidthsMin.assign(_channels, 0);
+    _activeWidthsMax.assign(_channels, 0);
+    _meValues.assign(_channels, 0.0f);
+    _ftjValues.assign(_channels, 0.0f);
+    _sifting.assign(_channels, 0);
+
+    _input = input.get_permute_axes("cxyz");
+    _residue.assign(_channels, _width, _height);
+    _bimf.assign(_channels, _width, _height);
+    _lowerEnvelope.assign(_channels, _width, _height);
+    _upperEnvelope.assign(_channels, _width, _height);
+
+    _detector.setSize(_parameters.size);
+}
+
+/**
+ * @brief Sift the channels in lockstep with shared filters widths, as a multivariate decomposition.
+ * The widths of each level are derived from the extremas of every channel, each extrema being
+ * paired with the nearest one of its own channel. The stop criteria apply to the channels as a
+ * whole, so that every channel has the same number of BEMCs, extracted at the same scales.
+ * @param sharedWidths True to share the widths, false to decompose each channel on its own
+ */
+void MultichannelFABEMD::setSharedWidths(bool sharedWidths)
+{
+    _sharedWidths = sharedWidths;
+}
+
+/**
+ * @brief Share a pool of workers with the decomposition, used by the extrema detection and the
+ * envelope filters.
+ * @param threadPool Pool of workers, which must outlive the decomposition, or 0
+ */
+void MultichannelFABEMD::setThreadPool(ThreadPool * threadPool)
+{
+    _threadPool = threadPool;
+}
+
+/**
+ * @brief Print the progress of the decomposition on the standard output, which is the default.
+ * @param verbose True to print the progress
+ */
+void MultichannelFABEMD::setVerbose(bool verbose)
+{
+    _verbose = verbose;
+}
+
+/**
+ * @brief Get the minimal or maximal distance from an extrema of given map to its nearest neighbour,
+ * with the distance backend of the parameters.
+ * @param extremas Extrema map of a channel
+ * @param largest True for the maximal distance, false for the minimal one
+ * @return Nearest extrema distance statistic, infinity if the map holds less than two extremas.
+ */
+float MultichannelFABEMD::nearestDistance(std::vector<Extrema> & extremas, bool largest)
+{
+    if (_parameters.distanceBackend == DISTANCE_TRANSFORM)
+    {
+        float statistic = largest && extremas.size() >= 2 ? 0.0f : std::numeric_limits<float>::infinity();
+        _distanceTransform.assignNearests(extremas, _width, _height);
+        for (std::vector<Extrema>::const_iterator i = extremas.begin(); i != extremas.end(); ++i)
+        {
+            statistic = largest ? std::max(statistic, i->distance()) : std::min(statistic, i->distance());
+        }
+        return statistic;
+    }
+
+    _grid.build(extremas, _width, _height);
+    return largest ? _grid.maximumNearestDistance() : _grid.minimumNearestDistance();
+}
+
+/**
+ * @brief Get the nearest extrema distance statistics of the maps of a channel, or of the maps of
+ * every channel when widths are shared.
+ * @param channel Channel
+ * @param largestMinima True for the maximal nearest minima distance, false for the minimal one
+ * @param largestMaxima True for the maximal nearest maxima distance, false for the minimal one
+ * @param minimaDistance Nearest minima distance statistic, infinity without two minimas in a channel
+ * @param maximaDistance Nearest maxima distance statistic, infinity without two maximas in a channel
+ */
+void MultichannelFABEMD::nearestDistances(unsigned int channel, bool largestMinima, bool largestMaxima,
+    float & minimaDistance, float & maximaDistance)
+{
+    const unsigned int first = _sharedWidths ? 0 : channel;
+    const unsigned int last = _sharedWidths ? _channels : channel + 1;
+    bool minimaFound = false;
+    bool maximaFound = false;
+
+    // Channels with less than two extremas of a kind have no distance of this kind
+    for (unsigned int c = first; c < last; ++c)
+    {
+        if (_localMinimas[c].size() >= 2)
+        {
+            float distance = nearestDistance(_localMinimas[c], largestMinima);
+            minimaDistance = !minimaFound ? distance :
+                largestMinima ? std::max(minimaDistance, distance) : std::min(minimaDistance, distance);
+            minimaFound = true;
+        }
+        if (_localMaximas[c].size() >= 2)
+        {
+            float distance = nearestDistance(_localMaximas[c], largestMaxima);
+            maximaDistance = !maximaFound ? distance :
+                largestMaxima ? std::max(maximaDistance, distance) : std::min(maximaDistance, distance);
+            maximaFound = true;
+        }
+    }
+
+    if (!minimaFound)
+    {
+        minimaDistance = std::numeric_limits<float>::infinity();
+    }
+    if (!maximaFound)
+    {
+        maximaDistance = std::numeric_limits<float>::infinity();
+    }
+}
+
+/**
+ * @brief Compute the order statistics filters widths of a channel, as FABEMD does, or the widths
+ * shared by every channel.
+ * @param channel Channel
+ */
+void MultichannelFABEMD::computeFiltersWidths(unsigned int channel)
+{
+    unsigned int & windowWidthMin = _windowWidthsMin[channel];
+    unsigned int & windowWidthMax = _windowWidthsMax[channel];
+    bool largestMinima;
+    bool largestMaxima;
+    float minimaDistance = 0.0f;
+    float maximaDistance = 0.0f;
+
+    if (FABEMD::nearestDistanceStatistics(_parameters.osfwType, largestMinima, largestMaxima))
+    {
+        nearestDistances(channel, largestMinima, largestMaxima, minimaDistance, maximaDistance);
+    }
+    FABEMD::filtersWidths(_parameters.osfwType, minimaDistance, maximaDistance, std::max(_width, _height),
+        windowWidthMin, windowWidthMax);
+
+    if (_sharedWidths)
+    {
+        std::fill(_windowWidthsMin.begin(), _windowWidthsMin.end(), windowWidthMin);
+        std::fill(_windowWidthsMax.begin(), _windowWidthsMax.end(), windowWidthMax);
+    }
+}
+
+/**
+ * @brief Compute and smooth the lower and upper envelopes of the channels being sifted.
+ * Each channel is filtered with its own widths, the other channels being skipped.
+ */
+void MultichannelFABEMD::computeEnvelopes()
+{
+    for (unsigned int c = 0; c < _channels; ++c)
+    {
+        _activeWidthsMin[c] = _sifting[c] ? _windowWidthsMin[c] : 0;
+        _activeWidthsMax[c] = _sifting[c] ? _windowWidthsMax[c] : 0;
+    }
+
+    _filter.interleavedMinimum(_bimf, _lowerEnvelope, _activeWidthsMin);
+    _filter.interleavedMaximum(_bimf, _upperEnvelope, _activeWidthsMax);
+    _filter.interleavedAverage(_lowerEnvelope, _lowerEnvelope, _activeWidthsMin);
+    _filter.interleavedAverage(_upperEnvelope, _upperEnvelope, _activeWidthsMax);
+}
+
+/**
+ * @brief Subtract the mean envelope from F_{T_j} of the channels being sifted, accumulating it into
+ * their residue, and get the variance of each of them, in a single pass over the image.
+ */
+void MultichannelFABEMD::subtractAverageEnvelope()
+{
+    const float * lower = _lowerEnvelope.data();
+    const float * upper = _upperEnvelope.data();
+    float * bimf = _bimf.data();
+    float * residue = _residue.data();
+    const unsigned int count = _width * _height * _channels;
+
+    std::fill(_meValues.begin(), _meValues.end(), 0.0f);
+    std::fill(_ftjValues.begin(), _ftjValues.end(), 0.0f);
+    for (unsigned int k = 0, c = 0; k < count; ++k, c = c + 1 < _channels ? c + 1 : 0)
+    {
+        if (!_sifting[c])
+        {
+            continue;
+        }
+
+        const float average = (lower[k] + upper[k]) / 2.0f;
+        _meValues[c] += average * average;
+        _ftjValues[c] += bimf[k] * bimf[k];
+        bimf[k] -= average;
+        residue[k] += average;
+    }
+
+    for (unsigned int c = 0; c < _channels; ++c)
+    {
+        if (_sifting[c])
+        {
+            _variances[c] = _meValues[c] / _ftjValues[c];
+        }
+    }
+
+    // Channels sifted in lockstep share the variance of all of them
+    if (_sharedWidths)
+    {
+        float meValue = 0.0f;
+        float ftjValue = 0.0f;
+        for (unsigned int c = 0; c < _channels; ++c)
+        {
+            meValue += _meValues[c];
+            ftjValue += _ftjValues[c];
+        }
+        std::fill(_variances.begin(), _variances.end(), meValue / ftjValue);
+    }
+}
+
+/**
+ * @brief Get the energy of the variations of a channel around a value.
+ * @param image Image with interleaved channels
+ * @param channel Channel
+ * @param mean Value around which variations are measured
+ * @return Sum of the squared differences between the pixels of the channel and the value.
+ */
+double MultichannelFABEMD::energy(const CImg<float> & image, unsigned int channel, double mean) const
+{
+    const float * values = image.data() + channel;
+    const unsigned int count = _width * _height;
+    double sum = 0.0;
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        sum += (values[i * _channels] - mean) * (values[i * _channels] - mean);
+    }
+
+    return sum;
+}
+
+/**
+ * @brief Tell whether the decomposition of a channel must stop, its remaining signal being output
+ * as residue.
+ * @param channel Channel
+ * @param bimfCount Number of BEMCs extracted
+ * @return True if the BEMC count or the remaining signal energy limit is reached.
+ */
+bool MultichannelFABEMD::limitReached(unsigned int channel, unsigned int bimfCount) const
+{
+    if (_parameters.maximumBimfCount > 0 && bimfCount >= _parameters.maximumBimfCount)
+    {
+        return true;
+    }
+    if (_parameters.energyThreshold <= 0.0f)
+    {
+        return false;
+    }
+    if (!_sharedWidths)
+    {
+        return energy(_residue, channel, _inputMeans[channel]) < _parameters.energyThreshold * _inputEnergies[channel];
+    }
+
+    // Channels sifted in lockstep stop together, on the energy of all of them
+    double remainingEnergy = 0.0;
+    double inputEnergy = 0.0;
+    for (unsigned int c = 0; c < _channels; ++c)
+    {
+        remainingEnergy += energy(_residue, c, _inputMeans[c]);
+        inputEnergy += _inputEnergies[c];
+    }
+    return remainingEnergy < _parameters.energyThreshold * inputEnergy;
+}
+
+/**
+ * @brief Copy a channel of an image with interleaved channels into a 2D image.
+ * @param image Image with interleaved channels
+ * @param channel Channel
+ * @return Image of the channel.
+ */
+CImg<float> MultichannelFABEMD::extractChannel(const CImg<float> & image, unsigned int channel) const
+{
+    CImg<float> result(_width, _height);
+    const float * values = image.data() + channel;
+
+    cimg_foroff(result, i)
+    {
+        result[i] = values[i * _channels];
+    }
+
+    return result;
+}
+
+/**
+ * @brief Execute computation of the BEMCs and residue of every channel.
+ * Channels are sifted together until each one stops, as FABEMD would stop on this channel alone,
+ * or until all of them stop when widths are shared.
+ * @return One image per channel, composed of the following slices:
+ * - The original channel
+ * - Every computed BEMC of the channel
+ * - The residue of the channel, when a limit is reached
+ */
+CImgList<float> MultichannelFABEMD::execute()
+{
+    std::vector<CImgList<float> > images(_channels);
+    std::vector<unsigned char> decomposing(_channels, 1);
+
+    _filter.setThreadPool(_threadPool);
+    _filter.reserve(std::max(_width, _height), _channels);
+    _detector.setThreadPool(_threadPool);
+    for (unsigned int c = 0; c < _channels; ++c)
+    {
+        images[c].insert(extractChannel(_input, c));
+        if (_parameters.energyThreshold > 0.0f)
+        {
+            _inputMeans[c] = images[c][0].mean();
+            _inputEnergies[c] = energy(_input, c, _inputMeans[c]);
+        }
+    }
+
+    // (i) Set i = 1. Take I and set S_i = I
+    unsigned int i = 1;
+    _residue = _input;
+    std::vector<unsigned int> extremas(_channels, 0);
+    while (std::find(decomposing.begin(), decomposing.end(), 1) != decomposing.end())
+    {
+        // (ii) Set j = 1. Set F_{T_j} = S_i.
+        unsigned int j = 1;
+        _residue.swap(_bimf);
+        _residue.fill(0.0f);
+        _sifting = decomposing;
+        do
+        {
+            // Maps are only used to get the filters widths when j equals 1, afterwards counting is enough
+            if (j == 1)
+            {
+                _detector.detectInterleaved(_bimf, _localMinimas, _localMaximas);
+                for (unsigned int c = 0; c < _channels; ++c)
+                {
+                    _extremaCounts[c] = (unsigned int)(_localMinimas[c].size() + _localMaximas[c].size());
+                    extremas[c] = _extremaCounts[c];
+                }
+            }
+            else
+            {
+                _detector.countInterleaved(_bimf, 3, _extremaCounts);
+            }
+
+            // Channels sifted in lockstep only stop when each of them has less than 3 extremas
+            if (_sharedWidths)
+            {
+                std::fill(_extremaCounts.begin(), _extremaCounts.end(),
+                    *std::max_element(_extremaCounts.begin(), _extremaCounts.end()));
+            }
+
+            // A channel whose BEMC has less than 3 extremas is over
+            for (unsigned int c = 0; c < _channels; ++c)
+            {
+                if (!_sifting[c])
+                {
+                    continue;
+                }
+                if (_extremaCounts[c] < 3)
+                {
+                    if (_verbose)
+                    {
+                        std::cout << "Channel " << c << ": BIMF has less than 3 extremas" << std::endl;
+                    }
+                    _sifting[c] = 0;
+                    decomposing[c] = 0;
+                }
+                else if (j == 1 && (!_sharedWidths || c == 0))
+                {
+                    computeFiltersWidths(c);
+                }
+            }
+
+            computeEnvelopes();
+            subtractAverageEnvelope();
+            ++j;
+
+            // (ix) Check whether F_{T_{j+1}} of each channel follows the BIMF properties
+            for (unsigned int c = 0; c < _channels; ++c)
+            {
+                if (!_sifting[c])
+                {
+                    continue;
+                }
+                if (_verbose)
+                {
+                    std::cout << "Channel " << c << ", ITS-BIMF-" << i << "-" << j - 1 << ": "
+                        << "variance of " << _variances[c] << "." << std::endl;
+                }
+                _sifting[c] = _variances[c] > _parameters.threshold && j <= _parameters.maximumAllowableIterations;
+            }
+        } while (std::find(_sifting.begin(), _sifting.end(), 1) != _sifting.end());
+
+        // Add the BEMC of each channel still decomposed, and its residue when a limit is reached
+        for (unsigned int c = 0; c < _channels; ++c)
+        {
+            if (!decomposing[c])
+            {
+                continue;
+            }
+            if (_verbose)
+            {
+                std::cout << "Channel " << c << ", BIMF-" << i << ": " << extremas[c] << " extremas." << std::endl;
+            }
+            images[c].insert(extractChannel(_bimf, c));
+            if (limitReached(c, i))
+            {
+                images[c].insert(extractChannel(_residue, c));
+                decomposing[c] = 0;
+            }
+        }
+        ++i;
+    }
+
+    CImgList<float> stacks(_channels);
+    for (unsigned int c = 0; c < _channels; ++c)
+    {
+        images[c].get_append('z').move_to(stacks[c]);
+    }
+
+    return stacks;
+}
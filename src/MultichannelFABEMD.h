@@ -0,0 +1,81 @@
+#ifndef __MULTICHANNEL_FABEMD_H__
+#define __MULTICHANNEL_FABEMD_H__
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "CImg.h"
+#include "DistanceTransform.h"
+#include "Extrema.h"
+#include "ExtremaDetector.h"
+#include "ExtremaGrid.h"
+#include "FABEMD.h"
+#include "SeparableFilter.h"
+#include "ThreadPool.h"
+
+class MultichannelFABEMD
+{
+private:
+    FABEMD::Parameters _parameters;
+    unsigned int _width;
+    unsigned int _height;
+    unsigned int _channels;
+    bool _sharedWidths;
+    ThreadPool * _threadPool;
+    bool _verbose;
+
+    std::vector<unsigned int> _windowWidthsMin;
+    std::vector<unsigned int> _windowWidthsMax;
+    std::vector<unsigned int> _extremaCounts;
+    std::vector<float> _variances;
+    std::vector<double> _inputMeans;
+    std::vector<double> _inputEnergies;
+    std::vector<unsigned int> _activeWidthsMin;
+    std::vector<unsigned int> _activeWidthsMax;
+    std::vector<float> _meValues;
+    std::vector<float> _ftjValues;
+    std::vector<unsigned char> _sifting;
+
+    cimg_library::CImg<float> _input;
+    cimg_library::CImg<float> _residue;
+    cimg_library::CImg<float> _bimf;
+    cimg_library::CImg<float> _lowerEnvelope;
+    cimg_library::CImg<float> _upperEnvelope;
+
+    std::vector<std::vector<Extrema> > _localMinimas;
+    std::vector<std::vector<Extrema> > _localMaximas;
+
+    ExtremaDetector _detector;
+    ExtremaGrid _grid;
+    DistanceTransform _distanceTransform;
+    SeparableFilter _filter;
+
+    void initialize(const cimg_library::CImg<float> & input);
+    float nearestDistance(std::vector<Extrema> & extremas, bool largest);
+    void nearestDistances(unsigned int channel, bool largestMinima, bool largestMaxima,
+        float & minimaDistance, float & maximaDistance);
+    void computeFiltersWidths(unsigned int channel);
+    void computeEnvelopes();
+    void subtractAverageEnvelope();
+    double energy(const cimg_library::CImg<float> & image, unsigned int channel, double mean) const;
+    bool limitReached(unsigned int channel, unsigned int bimfCount) const;
+    cimg_library::CImg<float> extractChannel(const cimg_library::CImg<float> & image, unsigned int channel) const;
+
+public:
+    MultichannelFABEMD(const cimg_library::CImg<float> & input, const FABEMD::Parameters & parameters);
+    MultichannelFABEMD(const cimg_library::CImgList<float> & images, const FABEMD::Parameters & parameters);
+
+    unsigned int width() const { return this->_width; }
+    unsigned int height() const { return this->_height; }
+    unsigned int channels() const { return this->_channels; }
+    bool sharedWidths() const { return this->_sharedWidths; }
+
+    void setThreadPool(ThreadPool * threadPool);
+    void setSharedWidths(bool sharedWidths);
+    void setVerbose(bool verbose);
+    cimg_library::CImgList<float> execute();
+};
+
+#endif // __MULTICHANNEL_FABEMD_H__
@@ -0,0 +1,732 @@
+#include "SeparableFilter.h"
+
+using namespace cimg_library;
+
+/**
+ * @brief Lines of one pass filtered by the thread pool, each worker with its own line buffers.
+ */
+class SeparableFilter::PassTask : public ThreadPool::Task
+{
+private:
+    SeparableFilter & _filter;
+    const Pass & _pass;
+    unsigned int _chunkCount;
+
+public:
+    PassTask(SeparableFilter & filter, const Pass & pass, unsigned int chunkCount)
+        : _filter(filter), _pass(pass), _chunkCount(chunkCount)
+    {
+    }
+
+    void run(unsigned int index, unsigned int worker)
+    {
+        _filter.runLines(_pass, _filter._buffers[worker],
+            index * _pass.lineCount / _chunkCount, (index + 1) * _pass.lineCount / _chunkCount);
+    }
+};
+
+/**
+ * @brief Create a separable filter. Line buffers grow with the lines filtered unless reserve() is
+ * called, and are reused between calls.
+ */
+SeparableFilter::SeparableFilter()
+    : _buffers(1)
+{
+    _threadPool = 0;
+    _reservedLength = 0;
+    _reservedChannels = 1;
+}
+
+/**
+ * @brief Set the thread pool filtering the lines of each pass.
+ * Every worker gets its own line buffers, sized as reserve() asked.
+ * @param threadPool Thread pool, or 0 to filter on the calling thread
+ */
+void SeparableFilter::setThreadPool(ThreadPool * threadPool)
+{
+    _threadPool = threadPool;
+    if (_threadPool && _buffers.size() < _threadPool->size())
+    {
+        unsigned int first = (unsigned int)_buffers.size();
+        _buffers.resize(_threadPool->size());
+        for (unsigned int i = first; i < _buffers.size(); ++i)
+        {
+            reserve(_buffers[i], _reservedLength, _reservedChannels);
+        }
+    }
+}
+
+/**
+ * @brief Allocate the line buffers of every worker for lines up to given length, with any window
+ * width. The pool hands chunks of lines to whichever worker is free, so that every worker may
+ * meet the longest line and the widest window: without this, a worker meeting them late would
+ * allocate after the first decomposition.
+ * @param length Largest line length, that is the largest image dimension
+ * @param channels Number of interleaved channels of the images, filtered a pixel at a time
+ */
+void SeparableFilter::reserve(unsigned int length, unsigned int channels)
+{
+    if (length <= _reservedLength && channels <= _reservedChannels)
+    {
+        return;
+    }
+    _reservedLength = std::max(length, _reservedLength);
+    _reservedChannels = std::max(channels, _reservedChannels);
+    for (unsigned int i = 0; i < _buffers.size(); ++i)
+    {
+        reserve(_buffers[i], _reservedLength, _reservedChannels);
+    }
+}
+
+/**
+ * @brief Allocate line buffers for lines up to given length.
+ * The window radius used on a line is below the line length, and the padded length is the
+ * largest for the largest radius.
+ * @param buffers Line buffers
+ * @param length Largest line length
+ * @param channels Number of channels of each element of a line
+ */
+void SeparableFilter::reserve(Buffers & buffers, unsigned int length, unsigned int channels)
+{
+    if (length == 0)
+    {
+        return;
+    }
+    unsigned int lineLength = paddedLength(length, length - 1) * channels;
+    buffers.line.reserve(lineLength);
+    buffers.pairedLine.reserve(lineLength);
+    buffers.prefix.reserve(lineLength);
+    buffers.suffix.reserve(lineLength);
+    buffers.sums.reserve((length + 1) * channels);
+}
+
+/**
+ * @brief Get the radius of the window actually used on a line.
+ * A window wider than twice the line always covers the whole line.
+ * @param length Number of elements of the line
+ * @param width Window width (odd)
+ * @return Window radius.
+ */
+unsigned int SeparableFilter::radius(unsigned int length, unsigned int width)
+{
+    return std::min((width - 1) / 2, length - 1);
+}
+
+/**
+ * @brief Get the length of a line padded on both sides by the window radius, rounded up to a
+ * multiple of the window width.
+ * @param length Number of elements of the line
+ * @param radius Window radius
+ * @return Padded line length.
+ */
+unsigned int SeparableFilter::paddedLength(unsigned int length, unsigned int radius)
+{
+    unsigned int blockWidth = 2 * radius + 1;
+    return ((length + 2 * radius + blockWidth - 1) / blockWidth) * blockWidth;
+}
+
+/**
+ * @brief Fill the padding of a gathered line with the identity element of the operation.
+ * The clamped window is then equivalent to a full window over the padded line.
+ * @param line Padded line, whose elements [radius, radius + length) are set
+ * @param length Number of elements of the line
+ * @param radius Window radius
+ */
+template<typename Operation>
+void SeparableFilter::pad(std::vector<float> & line, unsigned int length, unsigned int radius)
+{
+    std::fill(line.begin(), line.begin() + radius, Operation::identity());
+    std::fill(line.begin() + radius + length, line.end(), Operation::identity());
+}
+
+/**
+ * @brief Filter one padded line with the van Herk/Gil-Werman algorithm.
+ * Each output value costs a constant number of comparisons whatever the window width.
+ * @param buffers Line buffers of the calling thread
+ * @param line Padded line
+ * @param output First element of the output line
+ * @param length Number of elements of the line
+ * @param stride Distance between two consecutive elements of the output line
+ * @param radius Window radius
+ */
+template<typename Operation>
+void SeparableFilter::runLine(Buffers & buffers, const std::vector<float> & line, float * output,
+    unsigned int length, unsigned int stride, unsigned int radius)
+{
+    unsigned int blockWidth = 2 * radius + 1;
+    unsigned int lineLength = (unsigned int)line.size();
+    std::vector<float> & prefix = buffers.prefix;
+    std::vector<float> & suffix = buffers.suffix;
+
+    prefix.resize(lineLength);
+    suffix.resize(lineLength);
+
+    // Prefix and suffix values within each block of the window width
+    for (unsigned int block = 0; block < lineLength; block += blockWidth)
+    {
+        unsigned int last = block + blockWidth - 1;
+        prefix[block] = line[block];
+        for (unsigned int i = block + 1; i <= last; ++i)
+        {
+            prefix[i] = Operation::apply(prefix[i - 1], line[i]);
+        }
+        suffix[last] = line[last];
+        for (unsigned int i = last; i > block; --i)
+        {
+            suffix[i - 1] = Operation::apply(suffix[i], line[i - 1]);
+        }
+    }
+
+    // Any window spans at most two blocks
+    for (unsigned int i = 0; i < length; ++i)
+    {
+        output[i * stride] = Operation::apply(suffix[i], prefix[i + blockWidth - 1]);
+    }
+}
+
+/**
+ * @brief Filter one line, the window being clamped to the line.
+ * @param buffers Line buffers of the calling thread
+ * @param input First element of the input line
+ * @param output First element of the output line (may be the same as input)
+ * @param length Number of elements of the line
+ * @param stride Distance between two consecutive elements of the line
+ * @param width Window width (odd)
+ */
+template<typename Operation>
+void SeparableFilter::filterLine(Buffers & buffers, const float * input, float * output,
+    unsigned int length, unsigned int stride, unsigned int width)
+{
+    unsigned int r = radius(length, width);
+    std::vector<float> & line = buffers.line;
+
+    line.resize(paddedLength(length, r));
+    for (unsigned int i = 0; i < length; ++i)
+    {
+        line[r + i] = input[i * stride];
+    }
+    pad<Operation>(line, length, r);
+
+    runLine<Operation>(buffers, line, output, length, stride, r);
+}
+
+/**
+ * @brief Compute both the minimum and the maximum filters of one line, reading it only once.
+ * @param buffers Line buffers of the calling thread
+ * @param input First element of the input line
+ * @param lower First element of the minimum output line (may be the same as input)
+ * @param upper First element of the maximum output line (may be the same as input)
+ * @param length Number of elements of the line
+ * @param stride Distance between two consecutive elements of the lines
+ * @param width Window width (odd)
+ */
+void SeparableFilter::filterLinePair(Buffers & buffers, const float * input, float * lower, float * upper,
+    unsigned int length, unsigned int stride, unsigned int width)
+{
+    unsigned int r = radius(length, width);
+    std::vector<float> & line = buffers.line;
+    std::vector<float> & pairedLine = buffers.pairedLine;
+
+    line.resize(paddedLength(length, r));
+    pairedLine.resize(line.size());
+    for (unsigned int i = 0; i < length; ++i)
+    {
+        float value = input[i * stride];
+        line[r + i] = value;
+        pairedLine[r + i] = value;
+    }
+    pad<Minimum>(line, length, r);
+    pad<Maximum>(pairedLine, length, r);
+
+    runLine<Minimum>(buffers, line, lower, length, stride, r);
+    runLine<Maximum>(buffers, pairedLine, upper, length, stride, r);
+}
+
+/**
+ * @brief Average one line over a window whose out of line elements are clamped to the nearest
+ * end of the line, as the Neumann boundary conditions of CImg::convolve.
+ * The sums are read from the prefix sums of the line, so that each output value costs a constant
+ * number of operations whatever the window width, even wider than the line.
+ * @param buffers Line buffers of the calling thread
+ * @param input First element of the input line
+ * @param output First element of the output line (may be the same as input)
+ * @param length Number of elements of the line
+ * @param stride Distance between two consecutive elements of the line
+ * @param width Window width (odd)
+ */
+void SeparableFilter::averageLine(Buffers & buffers, const float * input, float * output,
+    unsigned int length, unsigned int stride, unsigned int width)
+{
+    // Window bounds are kept as doubles, as the window may be far wider than the line
+    const double radius = (width - 1) / 2;
+    const unsigned int last = length - 1;
+    std::vector<double> & sums = buffers.sums;
+
+    // sums[i] holds the sum of the i first elements
+    sums.resize(length + 1);
+    sums[0] = 0.0;
+    for (unsigned int i = 0; i < length; ++i)
+    {
+        sums[i + 1] = sums[i] + input[i * stride];
+    }
+
+    const double first = input[0];
+    const double end = input[last * stride];
+    for (unsigned int i = 0; i <= last; ++i)
+    {
+        double low = i - radius;
+        double high = i + radius;
+        double sum = sums[high > last ? last + 1 : (unsigned int)high + 1] - sums[low < 0 ? 0 : (unsigned int)low];
+
+        // Elements out of the line repeat the ends of the line
+        if (low < 0)
+        {
+            sum -= low * first;
+        }
+        if (high > last)
+        {
+            sum += (high - last) * end;
+        }
+        output[i * stride] = (float)(sum / width);
+    }
+}
+
+/**
+ * @brief Filter one line whose elements are the interleaved channels of a pixel, every channel
+ * with the same window, as filterLine() filters each channel alone.
+ * The channels of a pixel are contiguous in the buffers, so that each step of the filter handles
+ * them together in consecutive memory.
+ * @param buffers Line buffers of the calling thread
+ * @param input First channel of the first pixel of the input line
+ * @param output First channel of the first pixel of the output line (may be the same as input)
+ * @param length Number of pixels of the line
+ * @param stride Distance between two consecutive pixels of the line
+ * @param width Window width (odd)
+ * @param channels Number of channels of a pixel
+ */
+template<typename Operation>
+void SeparableFilter::filterPixelLine(Buffers & buffers, const float * input, float * output,
+    unsigned int length, unsigned int stride, unsigned int width, unsigned int channels)
+{
+    const unsigned int r = radius(length, width);
+    const unsigned int blockSize = (2 * r + 1) * channels;
+    const unsigned int size = paddedLength(length, r) * channels;
+    std::vector<float> & line = buffers.line;
+    std::vector<float> & prefix = buffers.prefix;
+    std::vector<float> & suffix = buffers.suffix;
+
+    line.resize(size);
+    prefix.resize(size);
+    suffix.resize(size);
+    std::fill(line.begin(), line.begin() + r * channels, Operation::identity());
+    for (unsigned int i = 0; i < length; ++i)
+    {
+        std::copy(input + i * stride, input + i * stride + channels, line.begin() + (r + i) * channels);
+    }
+    std::fill(line.begin() + (r + length) * channels, line.end(), Operation::identity());
+
+    // Prefix and suffix values within each block of the window width, a channel depending on the
+    // same channel of the previous or next pixel
+    for (unsigned int block = 0; block < size; block += blockSize)
+    {
+        unsigned int last = block + blockSize - channels;
+        for (unsigned int k = block; k < block + channels; ++k)
+        {
+            prefix[k] = line[k];
+        }
+        for (unsigned int k = block + channels; k < block + blockSize; ++k)
+        {
+            prefix[k] = Operation::apply(prefix[k - channels], line[k]);
+        }
+        for (unsigned int k = last; k < last + channels; ++k)
+        {
+            suffix[k] = line[k];
+        }
+        for (unsigned int k = last; k > block; --k)
+        {
+            suffix[k - 1] = Operation::apply(suffix[k - 1 + channels], line[k - 1]);
+        }
+    }
+
+    const unsigned int offset = blockSize - channels;
+    for (unsigned int i = 0; i < length; ++i)
+    {
+        float * pixel = output + i * stride;
+        const unsigned int k = i * channels;
+        for (unsigned int c = 0; c < channels; ++c)
+        {
+            pixel[c] = Operation::apply(suffix[k + c], prefix[k + offset + c]);
+        }
+    }
+}
+
+/**
+ * @brief Average one line whose elements are the interleaved channels of a pixel, every channel
+ * over the same window, as averageLine() averages each channel alone.
+ * @param buffers Line buffers of the calling thread
+ * @param input First channel of the first pixel of the input line
+ * @param output First channel of the first pixel of the output line (may be the same as input)
+ * @param length Number of pixels of the line
+ * @param stride Distance between two consecutive pixels of the line
+ * @param width Window width (odd)
+ * @param channels Number of channels of a pixel
+ */
+void SeparableFilter::averagePixelLine(Buffers & buffers, const float * input, float * output,
+    unsigned int length, unsigned int stride, unsigned int width, unsigned int channels)
+{
+    const double radius = (width - 1) / 2;
+    const unsigned int last = length - 1;
+    std::vector<double> & sums = buffers.sums;
+    std::vector<float> & ends = buffers.line;
+
+    // sums[i * channels + c] holds the sum of the i first elements of channel c
+    sums.resize((length + 1) * channels);
+    std::fill(sums.begin(), sums.begin() + channels, 0.0);
+    for (unsigned int i = 0; i < length; ++i)
+    {
+        const float * pixel = input + i * stride;
+        const unsigned int k = i * channels;
+        for (unsigned int c = 0; c < channels; ++c)
+        {
+            sums[k + channels + c] = sums[k + c] + pixel[c];
+        }
+    }
+
+    // Both ends of the line are kept apart, as the output may overwrite them
+    ends.resize(2 * channels);
+    std::copy(input, input + channels, ends.begin());
+    std::copy(input + last * stride, input + last * stride + channels, ends.begin() + channels);
+
+    for (unsigned int i = 0; i <= last; ++i)
+    {
+        double low = i - radius;
+        double high = i + radius;
+        const unsigned int lowSum = (low < 0 ? 0 : (unsigned int)low) * channels;
+        const unsigned int highSum = (high > last ? last + 1 : (unsigned int)high + 1) * channels;
+        float * pixel = output + i * stride;
+        for (unsigned int c = 0; c < channels; ++c)
+        {
+            double sum = sums[highSum + c] - sums[lowSum + c];
+            if (low < 0)
+            {
+                sum -= low * (double)ends[c];
+            }
+            if (high > last)
+            {
+                sum += (high - last) * (double)ends[channels + c];
+            }
+            pixel[c] = (float)(sum / width);
+        }
+    }
+}
+
+/**
+ * @brief Filter a range of the lines of a pass.
+ * Line i starts at element (i % groupSize) + (i / groupSize) * groupStride of the image, so
+ * that rows, columns of each slice and tubes across slices are all numbered the same way.
+ * The lines of an image with interleaved channels cycle through the channels, each one filtered
+ * with the width of its channel, and skipped if this width is 0, unless every channel shares the
+ * width: each line then holds every channel of its pixels, which are filtered together.
+ * @param pass Pass
+ * @param buffers Line buffers of the calling thread
+ * @param firstLine First line of the range
+ * @param lastLine Line following the last line of the range
+ */
+void SeparableFilter::runLines(const Pass & pass, Buffers & buffers, unsigned int firstLine, unsigned int lastLine)
+{
+    for (unsigned int i = firstLine; i < lastLine; ++i)
+    {
+        unsigned long offset = (unsigned long)(i % pass.groupSize) * pass.lineStep
+            + (unsigned long)(i / pass.groupSize) * pass.groupStride;
+        const float * input = pass.input + offset;
+        float * output = pass.output + offset;
+        unsigned int width = pass.channelWidths ? pass.channelWidths[i % pass.channelCount] : pass.width;
+        if (width == 0)
+        {
+            continue;
+        }
+
+        if (pass.pixelChannels > 1)
+        {
+            switch (pass.type)
+            {
+            case PASS_MINIMUM:
+                filterPixelLine<Minimum>(buffers, input, output, pass.length, pass.stride, width, pass.pixelChannels);
+                break;
+
+            case PASS_MAXIMUM:
+                filterPixelLine<Maximum>(buffers, input, output, pass.length, pass.stride, width, pass.pixelChannels);
+                break;
+
+            default:
+                averagePixelLine(buffers, input, output, pass.length, pass.stride, width, pass.pixelChannels);
+                break;
+            }
+            continue;
+        }
+
+        switch (pass.type)
+        {
+        case PASS_MINIMUM:
+            filterLine<Minimum>(buffers, input, output, pass.length, pass.stride, width);
+            break;
+
+        case PASS_MAXIMUM:
+            filterLine<Maximum>(buffers, input, output, pass.length, pass.stride, width);
+            break;
+
+        case PASS_MINIMUM_MAXIMUM:
+            filterLinePair(buffers, input, output, pass.pairedOutput + offset, pass.length, pass.stride, width);
+            break;
+
+        case PASS_AVERAGE:
+            averageLine(buffers, input, output, pass.length, pass.stride, width);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Filter all the lines of an image along one axis.
+ * With a thread pool, the lines are split into chunks filtered concurrently. Lines do not
+ * overlap, so that the result is the same as with a serial pass.
+ * @param type Filter applied to each line
+ * @param input Source image
+ * @param output Destination image, of the source dimensions (may be the same as input)
+ * @param pairedOutput Maximum destination image of a PASS_MINIMUM_MAXIMUM pass, 0 otherwise
+ * @param axis Axis of the lines, 'x', 'y' or 'z'
+ * @param width Window width (odd)
+ * @param channelWidths Window width of each channel of an image with interleaved channels along
+ * the x axis, replacing width, or 0
+ * @param pixelLines True to filter every channel of an image with interleaved channels along the
+ * x axis with width, a pixel at a time
+ */
+void SeparableFilter::run(PassType type, const CImg<float> & input, CImg<float> & output,
+    CImg<float> * pairedOutput, char axis, unsigned int width, const std::vector<unsigned int> * channelWidths,
+    bool pixelLines)
+{
+    const unsigned int imageWidth = (unsigned int)input.width();
+    const unsigned int imageHeight = (unsigned int)input.height();
+    const unsigned int imageDepth = (unsigned int)input.depth();
+    Pass pass;
+
+    pass.type = type;
+    pass.input = input.data();
+    pass.output = output.data();
+    pass.pairedOutput = pairedOutput ? pairedOutput->data() : 0;
+    pass.width = width;
+    pass.channelWidths = channelWidths ? &(*channelWidths)[0] : 0;
+    pass.channelCount = imageWidth;
+    pass.lineStep = 1;
+    pass.pixelChannels = 1;
+
+    switch (axis)
+    {
+    case 'x':
+        pass.lineCount = imageHeight * imageDepth;
+        pass.length = imageWidth;
+        pass.stride = 1;
+        pass.groupSize = 1;
+        pass.groupStride = imageWidth;
+        break;
+
+    case 'y':
+        pass.lineCount = imageWidth * imageDepth;
+        pass.length = imageHeight;
+        pass.stride = imageWidth;
+        pass.groupSize = imageWidth;
+        pass.groupStride = imageWidth * imageHeight;
+        break;
+
+    default:
+        pass.lineCount = imageWidth * imageHeight;
+        pass.length = imageDepth;
+        pass.stride = imageWidth * imageHeight;
+        pass.groupSize = pass.lineCount;
+        pass.groupStride = 0;
+        break;
+    }
+
+    // Each line covers the channels of its pixels, instead of one line per channel
+    if (pixelLines)
+    {
+        pass.lineCount /= imageWidth;
+        pass.groupSize /= imageWidth;
+        pass.lineStep = imageWidth;
+        pass.pixelChannels = imageWidth;
+    }
+
+    if (!_threadPool || _threadPool->size() == 1 || pass.lineCount < 2)
+    {
+        runLines(pass, _buffers[0], 0, pass.lineCount);
+        return;
+    }
+
+    // A few chunks per worker balance the load, each worker filtering into its own buffers
+    unsigned int chunkCount = std::min(pass.lineCount, 4 * _threadPool->size());
+
+    PassTask task(*this, pass, chunkCount);
+    _threadPool->run(task, chunkCount);
+}
+
+/**
+ * @brief Apply the operation over a width x width window centered on each pixel, or a
+ * width x width x width window centered on each voxel of a volume.
+ * The window is separated into a horizontal, a vertical and, for a volume, a depth pass.
+ * @param type PASS_MINIMUM or PASS_MAXIMUM
+ * @param input Source image
+ * @param output Destination image, resized to the source dimensions (may be the same as input)
+ * @param width Window width (odd)
+ */
+void SeparableFilter::filter(PassType type, const CImg<float> & input, CImg<float> & output, unsigned int width)
+{
+    if (&output != &input)
+    {
+        output.assign(input.width(), input.height(), input.depth());
+    }
+
+    run(type, input, output, 0, 'x', width);
+    run(type, output, output, 0, 'y', width);
+    if (input.depth() > 1)
+    {
+        run(type, output, output, 0, 'z', width);
+    }
+}
+
+/**
+ * @brief Compute the minimum over a width x width (x width) window centered on each pixel.
+ * @param input Source image
+ * @param output Destination image
+ * @param width Window width (odd)
+ */
+void SeparableFilter::minimum(const CImg<float> & input, CImg<float> & output, unsigned int width)
+{
+    filter(PASS_MINIMUM, input, output, width);
+}
+
+/**
+ * @brief Compute the maximum over a width x width (x width) window centered on each pixel.
+ * @param input Source image
+ * @param output Destination image
+ * @param width Window width (odd)
+ */
+void SeparableFilter::maximum(const CImg<float> & input, CImg<float> & output, unsigned int width)
+{
+    filter(PASS_MAXIMUM, input, output, width);
+}
+
+/**
+ * @brief Compute both the minimum and the maximum over a width x width (x width) window centered
+ * on each pixel. The horizontal pass reads the source image only once for both outputs.
+ * @param input Source image
+ * @param lower Minimum destination image
+ * @param upper Maximum destination image
+ * @param width Window width (odd)
+ */
+void SeparableFilter::minimumMaximum(const CImg<float> & input, CImg<float> & lower, CImg<float> & upper,
+    unsigned int width)
+{
+    lower.assign(input.width(), input.height(), input.depth());
+    upper.assign(input.width(), input.height(), input.depth());
+
+    run(PASS_MINIMUM_MAXIMUM, input, lower, &upper, 'x', width);
+    run(PASS_MINIMUM, lower, lower, 0, 'y', width);
+    run(PASS_MAXIMUM, upper, upper, 0, 'y', width);
+    if (input.depth() > 1)
+    {
+        run(PASS_MINIMUM, lower, lower, 0, 'z', width);
+        run(PASS_MAXIMUM, upper, upper, 0, 'z', width);
+    }
+}
+
+/**
+ * @brief Average each pixel over a width x width (x width) window centered on it.
+ * Pixels out of the image are clamped to the nearest border, so that the result matches
+ * CImg::convolve by a constant width x width (x width) kernel with its default boundary
+ * conditions.
+ * @param input Source image
+ * @param output Destination image, resized to the source dimensions (may be the same as input)
+ * @param width Window width (odd)
+ */
+void SeparableFilter::average(const CImg<float> & input, CImg<float> & output, unsigned int width)
+{
+    if (&output != &input)
+    {
+        output.assign(input.width(), input.height(), input.depth());
+    }
+
+    run(PASS_AVERAGE, input, output, 0, 'x', width);
+    run(PASS_AVERAGE, output, output, 0, 'y', width);
+    if (input.depth() > 1)
+    {
+        run(PASS_AVERAGE, output, output, 0, 'z', width);
+    }
+}
+
+/**
+ * @brief Apply the operation over a window centered on each pixel of a 2D image with interleaved
+ * channels, each channel with its own window width.
+ * @param type PASS_MINIMUM, PASS_MAXIMUM or PASS_AVERAGE
+ * @param input Source image, whose width() channels are interleaved, of height() columns and depth() rows
+ * @param output Destination image, resized to the source dimensions (may be the same as input)
+ * When every channel has the same width, the channels of each pixel are filtered together.
+ * @param widths Window width (odd) of each channel, the channels of width 0 being left untouched
+ */
+void SeparableFilter::filterInterleaved(PassType type, const CImg<float> & input, CImg<float> & output,
+    const std::vector<unsigned int> & widths)
+{
+    if (&output != &input)
+    {
+        output.assign(input.width(), input.height(), input.depth());
+    }
+
+    if (widths[0] > 0 && std::count(widths.begin(), widths.end(), widths[0]) == (std::ptrdiff_t)widths.size())
+    {
+        run(type, input, output, 0, 'y', widths[0], 0, true);
+        run(type, output, output, 0, 'z', widths[0], 0, true);
+        return;
+    }
+
+    run(type, input, output, 0, 'y', 0, &widths);
+    run(type, output, output, 0, 'z', 0, &widths);
+}
+
+/**
+ * @brief Compute the minimum over a width x width window centered on each pixel of a 2D image with
+ * interleaved channels, as given by CImg::get_permute_axes("cxyz").
+ * Each channel is filtered as minimum() filters it alone.
+ * @param input Source image, whose width() channels are interleaved, of height() columns and depth() rows
+ * @param output Destination image
+ * @param widths Window width (odd) of each channel, the channels of width 0 being left untouched
+ */
+void SeparableFilter::interleavedMinimum(const CImg<float> & input, CImg<float> & output,
+    const std::vector<unsigned int> & widths)
+{
+    filterInterleaved(PASS_MINIMUM, input, output, widths);
+}
+
+/**
+ * @brief Compute the maximum over a width x width window centered on each pixel of a 2D image with
+ * interleaved channels.
+ * @param input Source image, whose width() channels are interleaved, of height() columns and depth() rows
+ * @param output Destination image
+ * @param widths Window width (odd) of each channel, the channels of width 0 being left untouched
+ */
+void SeparableFilter::interleavedMaximum(const CImg<float> & input, CImg<float> & output,
+    const std::vector<unsigned int> & widths)
+{
+    filterInterleaved(PASS_MAXIMUM, input, output, widths);
+}
+
+/**
+ * @brief Average each pixel of a 2D image with interleaved channels over a width x width window
+ * centered on it, with the boundary conditions of average().
+ * @param input Source image, whose width() channels are interleaved, of height() columns and depth() rows
+ * @param output Destination image
+ * @param widths Window width (odd) of each channel, the channels of width 0 being left untouched
+ */
+void SeparableFilter::interleavedAverage(const CImg<float> & input, CImg<float> & output,
+    const std::vector<unsigned int> & widths)
+{
+    filterInterleaved(PASS_AVERAGE, input, output, widths);
+}
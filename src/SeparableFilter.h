@@ -0,0 +1,122 @@
+#ifndef __SEPARABLE_FILTER_H__
+#define __SEPARABLE_FILTER_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "CImg.h"
+#include "ThreadPool.h"
+
+class SeparableFilter
+{
+public:
+    struct Minimum
+    {
+        static float identity() { return std::numeric_limits<float>::infinity(); }
+        static float apply(float a, float b) { return b < a ? b : a; }
+    };
+
+    struct Maximum
+    {
+        static float identity() { return -std::numeric_limits<float>::infinity(); }
+        static float apply(float a, float b) { return b > a ? b : a; }
+    };
+
+private:
+    class PassTask;
+
+    enum PassType
+    {
+        PASS_MINIMUM,
+        PASS_MAXIMUM,
+        PASS_MINIMUM_MAXIMUM,
+        PASS_AVERAGE
+    };
+
+    struct Buffers
+    {
+        std::vector<float> line;
+        std::vector<float> pairedLine;
+        std::vector<float> prefix;
+        std::vector<float> suffix;
+        std::vector<double> sums;
+    };
+
+    struct Pass
+    {
+        PassType type;
+        const float * input;
+        float * output;
+        float * pairedOutput;
+        unsigned int lineCount;
+        unsigned int length;
+        unsigned int stride;
+        unsigned int groupSize;
+        unsigned int groupStride;
+        unsigned int width;
+        const unsigned int * channelWidths;
+        unsigned int channelCount;
+        unsigned int lineStep;
+        unsigned int pixelChannels;
+    };
+
+    ThreadPool * _threadPool;
+    std::vector<Buffers> _buffers;
+    unsigned int _reservedLength;
+    unsigned int _reservedChannels;
+
+    static unsigned int radius(unsigned int length, unsigned int width);
+    static unsigned int paddedLength(unsigned int length, unsigned int radius);
+    static void reserve(Buffers & buffers, unsigned int length, unsigned int channels);
+    template<typename Operation>
+    static void pad(std::vector<float> & line, unsigned int length, unsigned int radius);
+    template<typename Operation>
+    static void runLine(Buffers & buffers, const std::vector<float> & line, float * output,
+        unsigned int length, unsigned int stride, unsigned int radius);
+    template<typename Operation>
+    static void filterLine(Buffers & buffers, const float * input, float * output,
+        unsigned int length, unsigned int stride, unsigned int width);
+    static void filterLinePair(Buffers & buffers, const float * input, float * lower, float * upper,
+        unsigned int length, unsigned int stride, unsigned int width);
+    static void averageLine(Buffers & buffers, const float * input, float * output,
+        unsigned int length, unsigned int stride, unsigned int width);
+    template<typename Operation>
+    static void filterPixelLine(Buffers & buffers, const float * input, float * output,
+        unsigned int length, unsigned int stride, unsigned int width, unsigned int channels);
+    static void averagePixelLine(Buffers & buffers, const float * input, float * output,
+        unsigned int length, unsigned int stride, unsigned int width, unsigned int channels);
+    static void runLines(const Pass & pass, Buffers & buffers, unsigned int firstLine, unsigned int lastLine);
+    void run(PassType type, const cimg_library::CImg<float> & input, cimg_library::CImg<float> & output,
+        cimg_library::CImg<float> * pairedOutput, char axis, unsigned int width,
+        const std::vector<unsigned int> * channelWidths = 0, bool pixelLines = false);
+    void filter(PassType type, const cimg_library::CImg<float> & input, cimg_library::CImg<float> & output,
+        unsigned int width);
+    void filterInterleaved(PassType type, const cimg_library::CImg<float> & input,
+        cimg_library::CImg<float> & output, const std::vector<unsigned int> & widths);
+
+public:
+    SeparableFilter();
+
+    ThreadPool * threadPool() const { return this->_threadPool; }
+    void setThreadPool(ThreadPool * threadPool);
+    void reserve(unsigned int length, unsigned int channels = 1);
+
+    void minimum(const cimg_library::CImg<float> & input, cimg_library::CImg<float> & output,
+        unsigned int width);
+    void maximum(const cimg_library::CImg<float> & input, cimg_library::CImg<float> & output,
+        unsigned int width);
+    void minimumMaximum(const cimg_library::CImg<float> & input,
+        cimg_library::CImg<float> & lower, cimg_library::CImg<float> & upper, unsigned int width);
+    void average(const cimg_library::CImg<float> & input, cimg_library::CImg<float> & output,
+        unsigned int width);
+    void interleavedMinimum(const cimg_library::CImg<float> & input, cimg_library::CImg<float> & output,
+        const std::vector<unsigned int> & widths);
+    void interleavedMaximum(const cimg_library::CImg<float> & input, cimg_library::CImg<float> & output,
+        const std::vector<unsigned int> & widths);
+    void interleavedAverage(const cimg_library::CImg<float> & input, cimg_library::CImg<float> & output,
+        const std::vector<unsigned int> & widths);
+};
+
+#endif // __SEPARABLE_FILTER_H__
@@ -0,0 +1,208 @@
+#include "StreamingEnvelope.h"
+
+using namespace cimg_library;
+
+/**
+ * @brief Create the envelope of a stream of rows, as computed by FABEMD on a whole image: the
+ * order statistics filter over a window x window square, then its average over the same square.
+ * Only the rows within a window of the current row are kept.
+ * @param width Number of pixels of a row
+ * @param window Window width (odd)
+ * @param maximum True for the upper envelope, false for the lower one
+ * @param capacity Number of smoothed rows kept available, at least the window height
+ */
+StreamingEnvelope::StreamingEnvelope(unsigned int width, unsigned int window, bool maximum, unsigned int capacity)
+{
+    _width = width;
+    _radius = (window - 1) / 2;
+    _window = 2 * _radius + 1;
+    _capacity = std::max(capacity, _window);
+    _maximum = maximum;
+
+    _row.assign(width, 1);
+    _wedgeValues.resize((size_t)width * (_window + 1));
+    _wedgeRows.resize(_wedgeValues.size());
+    _wedgeFirsts.resize(width);
+    _wedgeSizes.resize(width);
+    _filtered.assign(width, _window + 1);
+    _sums.resize(width);
+    _smoothed.assign(width, _capacity);
+
+    reset();
+}
+
+/**
+ * @brief Forget the rows received, to start a new image.
+ */
+void StreamingEnvelope::reset()
+{
+    std::fill(_wedgeFirsts.begin(), _wedgeFirsts.end(), 0U);
+    std::fill(_wedgeSizes.begin(), _wedgeSizes.end(), 0U);
+    _received = 0;
+    _filteredCount = 0;
+    _smoothedCount = 0;
+}
+
+/**
+ * @brief Append a horizontally filtered row to the monotonic wedge of each column.
+ * A wedge holds the rows of the column that may still be the extremum of a window, in increasing
+ * row order and with increasing (decreasing) values for a maximum (minimum), so that the front
+ * of the wedge is the extremum of the window. Each row is pushed and popped once, so that the
+ * vertical filter costs a constant number of comparisons per pixel whatever the window width.
+ * @param row Horizontally filtered row
+ * @param index Index of the row in the image
+ */
+template<typename Operation>
+void StreamingEnvelope::pushWedges(const float * row, unsigned int index)
+{
+    const unsigned int capacity = _window + 1;
+
+    for (unsigned int x = 0; x < _width; ++x)
+    {
+        float * values = &_wedgeValues[x * capacity];
+        unsigned int * rows = &_wedgeRows[x * capacity];
+        unsigned int first = _wedgeFirsts[x];
+        unsigned int size = _wedgeSizes[x];
+        const float value = row[x];
+
+        // Rows not better than the new one can no longer be the extremum of a window
+        while (size > 0 && Operation::apply(values[(first + size - 1) % capacity], value) == value)
+        {
+            --size;
+        }
+        values[(first + size) % capacity] = value;
+        rows[(first + size) % capacity] = index;
+        _wedgeSizes[x] = size + 1;
+    }
+}
+
+/**
+ * @brief Compute the next row of the order statistics filter from the wedges, once the rows of
+ * its window are received (or the image is complete), and average it horizontally.
+ * @param index Index of the row in the image
+ */
+void StreamingEnvelope::emitOrderStatistics(unsigned int index)
+{
+    const unsigned int capacity = _window + 1;
+    float * row = _row.data();
+
+    for (unsigned int x = 0; x < _width; ++x)
+    {
+        const float * values = &_wedgeValues[x * capacity];
+        const unsigned int * rows = &_wedgeRows[x * capacity];
+        unsigned int first = _wedgeFirsts[x];
+        unsigned int size = _wedgeSizes[x];
+
+        // Drop the rows above the window
+        while (size > 1 && rows[first] + _radius < index)
+        {
+            first = (first + 1) % capacity;
+            --size;
+        }
+        row[x] = values[first];
+        _wedgeFirsts[x] = first;
+        _wedgeSizes[x] = size;
+    }
+
+    _filter.average(_row, _row, _window);
+    std::copy(row, row + _width, _filtered.data(0, index % capacity));
+    ++_filteredCount;
+}
+
+/**
+ * @brief Average vertically the filtered rows whose window is received.
+ * Each column keeps the running sum of its window, so that each row costs a constant number of
+ * operations per pixel. Rows out of the image are clamped to its first and last rows, as the
+ * Neumann boundary conditions of SeparableFilter::average.
+ * @param last Index of the last row of the image, or ~0U while the image is incomplete
+ */
+void StreamingEnvelope::smooth(unsigned int last)
+{
+    const unsigned int capacity = _window + 1;
+
+    while (_smoothedCount <= last)
+    {
+        const unsigned int y = _smoothedCount;
+        const unsigned int newest = std::min(y + _radius, last);
+        if (newest >= _filteredCount)
+        {
+            break;
+        }
+
+        if (y == 0)
+        {
+            std::fill(_sums.begin(), _sums.end(), 0.0);
+            for (int i = -(int)_radius; i <= (int)_radius; ++i)
+            {
+                const float * values = _filtered.data(0, std::min((unsigned int)std::max(i, 0), last) % capacity);
+                for (unsigned int x = 0; x < _width; ++x)
+                {
+                    _sums[x] += values[x];
+                }
+            }
+        }
+        else
+        {
+            const float * added = _filtered.data(0, newest % capacity);
+            const float * removed = _filtered.data(0, (y - 1 > _radius ? y - 1 - _radius : 0) % capacity);
+            for (unsigned int x = 0; x < _width; ++x)
+            {
+                _sums[x] += (double)added[x] - removed[x];
+            }
+        }
+
+        float * output = _smoothed.data(0, y % _capacity);
+        for (unsigned int x = 0; x < _width; ++x)
+        {
+            output[x] = (float)(_sums[x] / _window);
+        }
+        ++_smoothedCount;
+    }
+}
+
+/**
+ * @brief Receive the next row of the image.
+ * The smoothed envelope of a row is available once the row window / 2 rows below it is received.
+ * @param row Pixels of the row
+ */
+void StreamingEnvelope::push(const float * row)
+{
+    const unsigned int index = _received++;
+
+    std::copy(row, row + _width, _row.data());
+    if (_maximum)
+    {
+        _filter.maximum(_row, _row, _window);
+        pushWedges<SeparableFilter::Maximum>(_row.data(), index);
+    }
+    else
+    {
+        _filter.minimum(_row, _row, _window);
+        pushWedges<SeparableFilter::Minimum>(_row.data(), index);
+    }
+
+    if (index >= _radius)
+    {
+        emitOrderStatistics(index - _radius);
+        smooth(~0U);
+    }
+}
+
+/**
+ * @brief Tell that the last row of the image is received, so that the windows of the last rows
+ * are clamped to the image and their envelopes become available.
+ */
+void StreamingEnvelope::finish()
+{
+    if (_received == 0)
+    {
+        return;
+    }
+
+    // Smoothing follows each row, so that the ring of filtered rows is never overrun
+    while (_filteredCount < _received)
+    {
+        emitOrderStatistics(_filteredCount);
+        smooth(_received - 1);
+    }
+}
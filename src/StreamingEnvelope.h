@@ -0,0 +1,53 @@
+#ifndef __STREAMING_ENVELOPE_H__
+#define __STREAMING_ENVELOPE_H__
+
+#include <algorithm>
+#include <vector>
+
+#include "CImg.h"
+#include "SeparableFilter.h"
+
+class StreamingEnvelope
+{
+private:
+    unsigned int _width;
+    unsigned int _radius;
+    unsigned int _window;
+    unsigned int _capacity;
+    bool _maximum;
+
+    SeparableFilter _filter;
+    cimg_library::CImg<float> _row;
+    std::vector<float> _wedgeValues;
+    std::vector<unsigned int> _wedgeRows;
+    std::vector<unsigned int> _wedgeFirsts;
+    std::vector<unsigned int> _wedgeSizes;
+    cimg_library::CImg<float> _filtered;
+    std::vector<double> _sums;
+    cimg_library::CImg<float> _smoothed;
+
+    unsigned int _received;
+    unsigned int _filteredCount;
+    unsigned int _smoothedCount;
+
+    template<typename Operation>
+    void pushWedges(const float * row, unsigned int index);
+    void emitOrderStatistics(unsigned int index);
+    void smooth(unsigned int last);
+
+    StreamingEnvelope(const StreamingEnvelope &);
+    StreamingEnvelope & operator=(const StreamingEnvelope &);
+
+public:
+    StreamingEnvelope(unsigned int width, unsigned int window, bool maximum, unsigned int capacity);
+
+    unsigned int window() const { return this->_window; }
+    unsigned int smoothedCount() const { return this->_smoothedCount; }
+    const float * smoothed(unsigned int row) const { return this->_smoothed.data(0, row % this->_capacity); }
+
+    void reset();
+    void push(const float * row);
+    void finish();
+};
+
+#endif // __STREAMING_ENVELOPE_H__
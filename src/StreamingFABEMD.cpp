@@ -0,0 +1,152 @@
+#include "StreamingFABEMD.h"
+
+using namespace cimg_library;
+
+/**
+ * @brief Set up the streaming decomposition of images received row by row, as from a line scanner
+ * or a camera, into their first BEMC and its residue.
+ * Only the rows within the order statistics windows of the current row are kept, so that memory
+ * is proportional to the width times the window width, and each output row is written as soon as
+ * the rows its envelopes depend on are received, that is latency() rows later. The filters widths
+ * are set beforehand, for instance by FABEMD::firstFiltersWidths() on a reference image, since
+ * they depend on the extremas of the whole image. A single sifting iteration is done, the results
+ * matching those of FABEMD with one iteration and the same widths, up to the rounding of the
+ * smoothing sums.
+ * @param width Number of pixels of a row
+ * @param windowWidthMin Width of the order statistics filter of the lower envelope
+ * @param windowWidthMax Width of the order statistics filter of the upper envelope
+ * @param output Destination of the rows of the BEMC and the residue
+ * @param size Size of the extrema search window
+ */
+StreamingFABEMD::StreamingFABEMD(unsigned int width, unsigned int windowWidthMin, unsigned int windowWidthMax,
+    RowOutput & output, unsigned int size)
+    : _output(output),
+    _lower(width, windowWidthMin | 1, false, std::max(windowWidthMin | 1, windowWidthMax | 1)),
+    _upper(width, windowWidthMax | 1, true, std::max(windowWidthMin | 1, windowWidthMax | 1)),
+    _detector(size)
+{
+    // Even widths are rounded up to odd ones, as FABEMD does
+    _width = width;
+    _size = size;
+    _latency = std::max(windowWidthMin | 1, windowWidthMax | 1) - 1;
+    _extremaCount = 0;
+    _variance = 0.0f;
+    _meValue = 0.0f;
+    _ftjValue = 0.0f;
+    _extremaRows.assign(width, 2 * ((size - 1) / 2) + 1);
+    _extremaFirst = 0;
+    _input.assign(width, _latency + 1);
+    _bimf.assign(width, 1);
+    _residue.assign(width, 1);
+    _received = 0;
+    _emitted = 0;
+}
+
+/**
+ * @brief Count the extremas of a row, from the rows of its search window kept.
+ * @param row Row whose extremas are counted
+ * @param lastRow Last row of its search window, clamped to the image
+ */
+void StreamingFABEMD::detectRow(unsigned int row, unsigned int lastRow)
+{
+    const unsigned int firstRow = row - std::min((_size - 1) / 2, row);
+    const CImg<float> window = _extremaRows.get_shared_rows(firstRow - _extremaFirst, lastRow - _extremaFirst);
+
+    _minimas.clear();
+    _maximas.clear();
+    _detector.detectRows(window, row - firstRow, row - firstRow + 1, _minimas, _maximas);
+    _extremaCount += (unsigned int)(_minimas.size() + _maximas.size());
+}
+
+/**
+ * @brief Write the rows whose lower and upper envelopes are both smoothed.
+ * The BEMC is the row minus its mean envelope, and the residue the mean envelope.
+ */
+void StreamingFABEMD::emitRows()
+{
+    float * bimf = _bimf.data();
+    float * residue = _residue.data();
+
+    while (_emitted < _lower.smoothedCount() && _emitted < _upper.smoothedCount())
+    {
+        const float * lower = _lower.smoothed(_emitted);
+        const float * upper = _upper.smoothed(_emitted);
+        const float * input = _input.data(0, _emitted % _input.height());
+
+        for (unsigned int x = 0; x < _width; ++x)
+        {
+            const float average = (lower[x] + upper[x]) / 2.0f;
+            _meValue += average * average;
+            _ftjValue += input[x] * input[x];
+            bimf[x] = input[x] - average;
+            residue[x] = average;
+        }
+
+        _output.write(_emitted++, bimf, residue);
+    }
+}
+
+/**
+ * @brief Receive the next row of the image, writing the output rows it completes.
+ * The first row received after finish() starts a new image.
+ * @param row Pixels of the row
+ */
+void StreamingFABEMD::push(const float * row)
+{
+    const unsigned int index = _received++;
+    const unsigned int halfSize = (_size - 1) / 2;
+
+    if (index == 0)
+    {
+        _extremaCount = 0;
+        _meValue = 0.0f;
+        _ftjValue = 0.0f;
+    }
+    std::copy(row, row + _width, _input.data(0, index % _input.height()));
+
+    // The rows of the extrema search window are kept contiguous, so that the detector sees an image
+    if (index - _extremaFirst == (unsigned int)_extremaRows.height())
+    {
+        std::copy(_extremaRows.data(0, 1), _extremaRows.end(), _extremaRows.data());
+        ++_extremaFirst;
+    }
+    std::copy(row, row + _width, _extremaRows.data(0, index - _extremaFirst));
+    if (index >= halfSize)
+    {
+        detectRow(index - halfSize, index);
+    }
+
+    _lower.push(row);
+    _upper.push(row);
+    emitRows();
+}
+
+/**
+ * @brief Tell that the last row of the image is received, writing the remaining output rows.
+ * The extrema count and variance of the image are then available, and the next row received
+ * starts a new image.
+ */
+void StreamingFABEMD::finish()
+{
+    if (_received == 0)
+    {
+        return;
+    }
+
+    const unsigned int halfSize = (_size - 1) / 2;
+    for (unsigned int row = _received - std::min(halfSize, _received); row < _received; ++row)
+    {
+        detectRow(row, _received - 1);
+    }
+
+    _lower.finish();
+    _upper.finish();
+    emitRows();
+    _variance = _meValue / _ftjValue;
+
+    _lower.reset();
+    _upper.reset();
+    _extremaFirst = 0;
+    _received = 0;
+    _emitted = 0;
+}
@@ -0,0 +1,66 @@
+#ifndef __STREAMING_FABEMD_H__
+#define __STREAMING_FABEMD_H__
+
+#include <algorithm>
+#include <vector>
+
+#include "CImg.h"
+#include "Extrema.h"
+#include "ExtremaDetector.h"
+#include "StreamingEnvelope.h"
+
+class StreamingFABEMD
+{
+public:
+    class RowOutput
+    {
+    public:
+        virtual ~RowOutput() {}
+        virtual void write(unsigned int row, const float * bimf, const float * residue) = 0;
+    };
+
+private:
+    unsigned int _width;
+    unsigned int _size;
+    unsigned int _latency;
+    unsigned int _extremaCount;
+    float _variance;
+    float _meValue;
+    float _ftjValue;
+
+    RowOutput & _output;
+    StreamingEnvelope _lower;
+    StreamingEnvelope _upper;
+
+    ExtremaDetector _detector;
+    cimg_library::CImg<float> _extremaRows;
+    unsigned int _extremaFirst;
+    std::vector<Extrema> _minimas;
+    std::vector<Extrema> _maximas;
+
+    cimg_library::CImg<float> _input;
+    cimg_library::CImg<float> _bimf;
+    cimg_library::CImg<float> _residue;
+    unsigned int _received;
+    unsigned int _emitted;
+
+    void detectRow(unsigned int row, unsigned int lastRow);
+    void emitRows();
+
+    StreamingFABEMD(const StreamingFABEMD &);
+    StreamingFABEMD & operator=(const StreamingFABEMD &);
+
+public:
+    StreamingFABEMD(unsigned int width, unsigned int windowWidthMin, unsigned int windowWidthMax,
+        RowOutput & output, unsigned int size = 3);
+
+    unsigned int width() const { return this->_width; }
+    unsigned int latency() const { return this->_latency; }
+    unsigned int extremaCount() const { return this->_extremaCount; }
+    float variance() const { return this->_variance; }
+
+    void push(const float * row);
+    void finish();
+};
+
+#endif // __STREAMING_FABEMD_H__
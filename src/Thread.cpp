@@ -0,0 +1,125 @@
+#include "Thread.h"
+
+/**
+ * @brief Create an unlocked mutex.
+ */
+Mutex::Mutex()
+{
+#ifdef _WIN32
+    InitializeCriticalSection(&_mutex);
+#else
+    pthread_mutex_init(&_mutex, 0);
+#endif
+}
+
+/**
+ * @brief Destroy the mutex, which must be unlocked.
+ */
+Mutex::~Mutex()
+{
+#ifdef _WIN32
+    DeleteCriticalSection(&_mutex);
+#else
+    pthread_mutex_destroy(&_mutex);
+#endif
+}
+
+/**
+ * @brief Wait until the mutex is available and lock it.
+ */
+void Mutex::lock()
+{
+#ifdef _WIN32
+    EnterCriticalSection(&_mutex);
+#else
+    pthread_mutex_lock(&_mutex);
+#endif
+}
+
+/**
+ * @brief Unlock the mutex, locked by the calling thread.
+ */
+void Mutex::unlock()
+{
+#ifdef _WIN32
+    LeaveCriticalSection(&_mutex);
+#else
+    pthread_mutex_unlock(&_mutex);
+#endif
+}
+
+/**
+ * @brief Create a thread object, started later by start().
+ */
+Thread::Thread()
+{
+    _task = 0;
+    _running = false;
+}
+
+/**
+ * @brief Wait for the end of the task before destroying the thread.
+ */
+Thread::~Thread()
+{
+    join();
+}
+
+/**
+ * @brief Run given task in a new thread, as task.run(0, 0).
+ * A thread already running is joined first. If no thread can be started, the task is run on the
+ * calling thread, start() then returning once it is done.
+ * @param task Task, which must outlive the thread
+ */
+void Thread::start(ThreadPool::Task & task)
+{
+    join();
+
+    _task = &task;
+#ifdef _WIN32
+    _thread = CreateThread(0, 0, threadMain, this, 0, 0);
+    _running = _thread != 0;
+#else
+    _running = pthread_create(&_thread, 0, threadMain, this) == 0;
+#endif
+    if (!_running)
+    {
+        _task = 0;
+        task.run(0, 0);
+    }
+}
+
+/**
+ * @brief Wait for the end of the task, if any is running.
+ */
+void Thread::join()
+{
+    if (!_running)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    WaitForSingleObject(_thread, INFINITE);
+    CloseHandle(_thread);
+#else
+    pthread_join(_thread, 0);
+#endif
+    _running = false;
+    _task = 0;
+}
+
+/**
+ * @brief Entry point of the thread.
+ * @param argument Thread object
+ */
+#ifdef _WIN32
+DWORD WINAPI Thread::threadMain(LPVOID argument)
+#else
+void * Thread::threadMain(void * argument)
+#endif
+{
+    Thread * thread = (Thread *)argument;
+    thread->_task->run(0, 0);
+    return 0;
+}
@@ -0,0 +1,62 @@
+#ifndef __THREAD_H__
+#define __THREAD_H__
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "ThreadPool.h"
+
+class Mutex
+{
+private:
+#ifdef _WIN32
+    CRITICAL_SECTION _mutex;
+#else
+    pthread_mutex_t _mutex;
+#endif
+
+    Mutex(const Mutex &);
+    Mutex & operator=(const Mutex &);
+
+public:
+    Mutex();
+    ~Mutex();
+
+    void lock();
+    void unlock();
+};
+
+class Thread
+{
+private:
+#ifdef _WIN32
+    HANDLE _thread;
+#else
+    pthread_t _thread;
+#endif
+    ThreadPool::Task * _task;
+    bool _running;
+
+#ifdef _WIN32
+    static DWORD WINAPI threadMain(LPVOID argument);
+#else
+    static void * threadMain(void * argument);
+#endif
+
+    Thread(const Thread &);
+    Thread & operator=(const Thread &);
+
+public:
+    Thread();
+    ~Thread();
+
+    bool running() const { return this->_running; }
+
+    void start(ThreadPool::Task & task);
+    void join();
+};
+
+#endif // __THREAD_H__
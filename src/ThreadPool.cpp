@@ -0,0 +1,237 @@
+#include "ThreadPool.h"
+
+/**
+ * @brief Get the number of processors available to the process.
+ * @return Number of processors, at least 1.
+ */
+unsigned int ThreadPool::hardwareConcurrency()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (unsigned int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned int)count : 1;
+#endif
+}
+
+/**
+ * @brief Start a pool of workers.
+ * The thread calling run() takes part in the work, so size - 1 threads are started. If some cannot
+ * be started, the pool has fewer workers, down to the calling thread alone.
+ * @param size Number of workers, 0 for one worker per processor
+ */
+ThreadPool::ThreadPool(unsigned int size)
+{
+    if (size == 0)
+    {
+        size = hardwareConcurrency();
+    }
+
+    _task = 0;
+    _count = 0;
+    _next = 0;
+    _active = 0;
+    _generation = 0;
+    _stopping = false;
+
+#ifdef _WIN32
+    InitializeCriticalSection(&_mutex);
+    InitializeConditionVariable(&_workAvailable);
+    InitializeConditionVariable(&_workDone);
+#else
+    pthread_mutex_init(&_mutex, 0);
+    pthread_cond_init(&_workAvailable, 0);
+    pthread_cond_init(&_workDone, 0);
+#endif
+
+    // Workers are stored before any thread starts, so that their addresses are stable
+    _workers.resize(size - 1);
+    _threads.resize(size - 1);
+    unsigned int started = 0;
+    while (started < _workers.size())
+    {
+        _workers[started].pool = this;
+        _workers[started].index = started + 1;
+#ifdef _WIN32
+        _threads[started] = CreateThread(0, 0, workerMain, &_workers[started], 0, 0);
+        if (_threads[started] == 0)
+#else
+        if (pthread_create(&_threads[started], 0, workerMain, &_workers[started]) != 0)
+#endif
+        {
+            break;
+        }
+        ++started;
+    }
+
+    // When the system refuses a thread, the pool keeps the workers started, so that run() only
+    // waits for threads that exist and size() gives the actual number of workers
+    _threads.resize(started);
+}
+
+/**
+ * @brief Stop and join the workers.
+ */
+ThreadPool::~ThreadPool()
+{
+    lock();
+    _stopping = true;
+#ifdef _WIN32
+    WakeAllConditionVariable(&_workAvailable);
+#else
+    pthread_cond_broadcast(&_workAvailable);
+#endif
+    unlock();
+
+    for (unsigned int i = 0; i < _threads.size(); ++i)
+    {
+#ifdef _WIN32
+        WaitForSingleObject(_threads[i], INFINITE);
+        CloseHandle(_threads[i]);
+#else
+        pthread_join(_threads[i], 0);
+#endif
+    }
+
+#ifdef _WIN32
+    DeleteCriticalSection(&_mutex);
+#else
+    pthread_cond_destroy(&_workDone);
+    pthread_cond_destroy(&_workAvailable);
+    pthread_mutex_destroy(&_mutex);
+#endif
+}
+
+void ThreadPool::lock()
+{
+#ifdef _WIN32
+    EnterCriticalSection(&_mutex);
+#else
+    pthread_mutex_lock(&_mutex);
+#endif
+}
+
+void ThreadPool::unlock()
+{
+#ifdef _WIN32
+    LeaveCriticalSection(&_mutex);
+#else
+    pthread_mutex_unlock(&_mutex);
+#endif
+}
+
+void ThreadPool::waitWork()
+{
+#ifdef _WIN32
+    SleepConditionVariableCS(&_workAvailable, &_mutex, INFINITE);
+#else
+    pthread_cond_wait(&_workAvailable, &_mutex);
+#endif
+}
+
+void ThreadPool::waitDone()
+{
+#ifdef _WIN32
+    SleepConditionVariableCS(&_workDone, &_mutex, INFINITE);
+#else
+    pthread_cond_wait(&_workDone, &_mutex);
+#endif
+}
+
+/**
+ * @brief Run the remaining indices of the current task. Must be called with the mutex locked.
+ * @param worker Index of the calling worker
+ */
+void ThreadPool::work(unsigned int worker)
+{
+    while (_next < _count)
+    {
+        unsigned int index = _next++;
+        unlock();
+        _task->run(index, worker);
+        lock();
+    }
+}
+
+#ifdef _WIN32
+DWORD WINAPI ThreadPool::workerMain(LPVOID argument)
+#else
+void * ThreadPool::workerMain(void * argument)
+#endif
+{
+    Worker * worker = (Worker *)argument;
+    ThreadPool * pool = worker->pool;
+    unsigned long generation = 0;
+
+    pool->lock();
+    while (true)
+    {
+        while (!pool->_stopping && pool->_generation == generation)
+        {
+            pool->waitWork();
+        }
+        if (pool->_stopping)
+        {
+            break;
+        }
+        generation = pool->_generation;
+
+        pool->work(worker->index);
+
+        // The last worker to check in releases run()
+        if (--pool->_active == 0)
+        {
+#ifdef _WIN32
+            WakeAllConditionVariable(&pool->_workDone);
+#else
+            pthread_cond_broadcast(&pool->_workDone);
+#endif
+        }
+    }
+    pool->unlock();
+
+    return 0;
+}
+
+/**
+ * @brief Call task.run(index, worker) for each index in [0, count), and wait for all calls to end.
+ * Indices are handed out one at a time to the workers, in increasing order. The worker index is
+ * in [0, size()), and no two calls with the same worker index run at the same time, so that it
+ * can select per-worker buffers.
+ * @param task Task to run
+ * @param count Number of indices
+ */
+void ThreadPool::run(Task & task, unsigned int count)
+{
+    if (_threads.empty() || count <= 1)
+    {
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            task.run(i, 0);
+        }
+        return;
+    }
+
+    lock();
+    _task = &task;
+    _count = count;
+    _next = 0;
+    _active = (unsigned int)_threads.size();
+    ++_generation;
+#ifdef _WIN32
+    WakeAllConditionVariable(&_workAvailable);
+#else
+    pthread_cond_broadcast(&_workAvailable);
+#endif
+
+    work(0);
+
+    while (_active > 0)
+    {
+        waitDone();
+    }
+    _task = 0;
+    unlock();
+}
@@ -0,0 +1,76 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+class ThreadPool
+{
+public:
+    class Task
+    {
+    public:
+        virtual ~Task() {}
+        virtual void run(unsigned int index, unsigned int worker) = 0;
+    };
+
+private:
+    struct Worker
+    {
+        ThreadPool * pool;
+        unsigned int index;
+    };
+
+#ifdef _WIN32
+    std::vector<HANDLE> _threads;
+    CRITICAL_SECTION _mutex;
+    CONDITION_VARIABLE _workAvailable;
+    CONDITION_VARIABLE _workDone;
+#else
+    std::vector<pthread_t> _threads;
+    pthread_mutex_t _mutex;
+    pthread_cond_t _workAvailable;
+    pthread_cond_t _workDone;
+#endif
+    std::vector<Worker> _workers;
+
+    Task * _task;
+    unsigned int _count;
+    unsigned int _next;
+    unsigned int _active;
+    unsigned long _generation;
+    bool _stopping;
+
+    void lock();
+    void unlock();
+    void waitWork();
+    void waitDone();
+    void work(unsigned int worker);
+
+#ifdef _WIN32
+    static DWORD WINAPI workerMain(LPVOID argument);
+#else
+    static void * workerMain(void * argument);
+#endif
+
+    ThreadPool(const ThreadPool &);
+    ThreadPool & operator=(const ThreadPool &);
+
+public:
+    static unsigned int hardwareConcurrency();
+
+    explicit ThreadPool(unsigned int size = 0);
+    ~ThreadPool();
+
+    unsigned int size() const { return (unsigned int)this->_threads.size() + 1; }
+
+    void run(Task & task, unsigned int count);
+};
+
+#endif // __THREAD_POOL_H__
@@ -0,0 +1,679 @@
+#include "TiledFABEMD.h"
+
+using namespace cimg_library;
+
+namespace
+{
+    /**
+     * @brief Keep the extremas of a range of columns of a loaded block, moved to image coordinates.
+     * @param extremas Extremas detected in the block, with block coordinates
+     * @param firstColumn First column kept, in the block
+     * @param lastColumn Column following the last column kept, in the block
+     * @param blockLeft Column of the block in the image
+     * @param blockTop Row of the block in the image
+     */
+    void keepColumns(std::vector<Extrema> & extremas, unsigned int firstColumn, unsigned int lastColumn,
+        unsigned int blockLeft, unsigned int blockTop)
+    {
+        unsigned int kept = 0;
+
+        for (unsigned int i = 0; i < extremas.size(); ++i)
+        {
+            if (extremas[i].x() >= firstColumn && extremas[i].x() < lastColumn)
+            {
+                extremas[kept++] = Extrema(extremas[i].x() + blockLeft, extremas[i].y() + blockTop);
+            }
+        }
+        extremas.resize(kept);
+    }
+}
+
+/**
+ * @brief Set up the out-of-core decomposition of a .cimg file.
+ * The image is processed by square tiles, each one loaded with the pixels around it that its
+ * result depends on (its halo), so that only a tile and its halo are in memory at a time. The
+ * image, the BEMCs being sifted and the residue live in files. The results match those of FABEMD
+ * on the whole image, up to the rounding of the smoothing sums.
+ * The halos grow with the filters widths, and the nearest neighbour searches of the extremas of a
+ * tile with the distance to their neighbours, so the decomposition stops with a
+ * CImgInstanceException rather than exceed the memory budget.
+ * @param filename Source image, an uncompressed 2D .cimg file (see ImageFile)
+ * @param parameters Parameters of the decomposition
+ * @param tileSize Number of rows and columns of a tile, without its halo
+ * @param memoryBudget Number of bytes the tiles, their halos and the extremas around a tile may take
+ */
+TiledFABEMD::TiledFABEMD(const char * filename, const FABEMD::Parameters & parameters, unsigned int tileSize,
+    size_t memoryBudget)
+    : _parameters(parameters)
+{
+    _input.open(filename);
+    _width = _input.width();
+    _height = _input.height();
+    _tileSize = std::max(1U, tileSize);
+    _memoryBudget = memoryBudget;
+    _windowWidthMax = 3;
+    _windowWidthMin = 3;
+    _extremaCount = 0;
+    _minimaDistance = 0.0f;
+    _maximaDistance = 0.0f;
+    _variance = 0.0f;
+    _inputMean = 0.0;
+    _inputEnergy = 0.0;
+    _threadPool = 0;
+    _verbose = true;
+    _residue = &_files[0];
+    _bimf = &_files[1];
+    _next = &_files[2];
+}
+
+/**
+ * @brief Share a pool of workers with the decomposition, used within each tile.
+ * @param threadPool Pool of workers, which must outlive the decomposition, or 0
+ */
+void TiledFABEMD::setThreadPool(ThreadPool * threadPool)
+{
+    _threadPool = threadPool;
+}
+
+/**
+ * @brief Print the progress of the decomposition on the standard output, which is the default.
+ * @param verbose True to print the progress
+ */
+void TiledFABEMD::setVerbose(bool verbose)
+{
+    _verbose = verbose;
+}
+
+/**
+ * @brief Load a tile and its halo, clamped to the image.
+ * @param file Source file
+ * @param left First column of the tile
+ * @param top First row of the tile
+ * @param right Column following the last column of the tile
+ * @param bottom Row following the last row of the tile
+ * @param halo Number of columns and rows loaded on each side of the tile
+ * @param block Destination image, resized to the loaded pixels
+ * @param blockLeft Set to the column in the file of the first loaded column
+ * @param blockTop Set to the row in the file of the first loaded row
+ */
+void TiledFABEMD::loadBlock(ImageFile & file, unsigned int left, unsigned int top, unsigned int right,
+    unsigned int bottom, unsigned int halo, CImg<float> & block, unsigned int & blockLeft, unsigned int & blockTop)
+{
+    blockLeft = left - std::min(halo, left);
+    blockTop = top - std::min(halo, top);
+    unsigned int blockRight = right + std::min(halo, _width - right);
+    unsigned int blockBottom = bottom + std::min(halo, _height - bottom);
+
+    block.assign(blockRight - blockLeft, blockBottom - blockTop);
+    file.readBlock(blockLeft, blockTop, blockRight - blockLeft, blockBottom - blockTop, block.data());
+}
+
+/**
+ * @brief Detect the extremas of a tile of the BEMC being sifted.
+ * The tile is loaded with a halo of half the search window, so that its extremas are the same as
+ * in the whole image. The workspace maps are filled in row-major order, with image coordinates.
+ * @param left First column of the tile
+ * @param top First row of the tile
+ * @param right Column following the last column of the tile
+ * @param bottom Row following the last row of the tile
+ */
+void TiledFABEMD::detectTile(unsigned int left, unsigned int top, unsigned int right, unsigned int bottom)
+{
+    CImg<float> & block = _workspace.bimf();
+    const unsigned int halo = (_parameters.size - 1) / 2;
+    unsigned int blockLeft;
+    unsigned int blockTop;
+
+    checkMemory(sizeof(float) * (size_t)(right - left + 2 * halo) * (bottom - top + 2 * halo),
+        "the tiles searched for extremas");
+    loadBlock(*_bimf, left, top, right, bottom, halo, block, blockLeft, blockTop);
+
+    _workspace.localMinimas().clear();
+    _workspace.localMaximas().clear();
+    _workspace.detector().detectRows(block, top - blockTop, bottom - blockTop,
+        _workspace.localMinimas(), _workspace.localMaximas());
+    keepColumns(_workspace.localMinimas(), left - blockLeft, right - blockLeft, blockLeft, blockTop);
+    keepColumns(_workspace.localMaximas(), left - blockLeft, right - blockLeft, blockLeft, blockTop);
+}
+
+/**
+ * @brief Detect the extremas of an area of the BEMC being sifted, tile after tile, appending them to
+ * the extremas of the searched region.
+ * @param left First column of the area
+ * @param top First row of the area
+ * @param right Column following the last column of the area
+ * @param bottom Row following the last row of the area
+ */
+void TiledFABEMD::detectArea(unsigned int left, unsigned int top, unsigned int right, unsigned int bottom)
+{
+    for (unsigned int y = top; y < bottom; y += _tileSize)
+    {
+        for (unsigned int x = left; x < right; x += _tileSize)
+        {
+            detectTile(x, y, std::min(right, x + _tileSize), std::min(bottom, y + _tileSize));
+            _regionMinimas.insert(_regionMinimas.end(),
+                _workspace.localMinimas().begin(), _workspace.localMinimas().end());
+            _regionMaximas.insert(_regionMaximas.end(),
+                _workspace.localMaximas().begin(), _workspace.localMaximas().end());
+        }
+    }
+}
+
+/**
+ * @brief Throw if the memory needed by a step of the decomposition exceeds the budget.
+ * @param bytes Number of bytes needed
+ * @param usage Description of what needs the memory
+ */
+void TiledFABEMD::checkMemory(size_t bytes, const char * usage) const
+{
+    if (bytes > _memoryBudget)
+    {
+        throw CImgInstanceException("TiledFABEMD: %s need %lu MiB, over the memory budget of %lu MiB.",
+            usage, (unsigned long)((bytes + (1 << 20) - 1) >> 20), (unsigned long)(_memoryBudget >> 20));
+    }
+}
+
+/**
+ * @brief Count the minimas and maximas of the BEMC being sifted, tile after tile.
+ * @param limit Count from which counting stops early
+ */
+void TiledFABEMD::countExtremas(unsigned int limit)
+{
+    _extremaCount = 0;
+    for (unsigned int top = 0; top < _height && _extremaCount < limit; top += _tileSize)
+    {
+        for (unsigned int left = 0; left < _width && _extremaCount < limit; left += _tileSize)
+        {
+            detectTile(left, top, std::min(_width, left + _tileSize), std::min(_height, top + _tileSize));
+            _extremaCount += (unsigned int)(_workspace.localMinimas().size() + _workspace.localMaximas().size());
+        }
+    }
+}
+
+/**
+ * @brief Search the nearest neighbours of the extremas of a tile among the extremas of a region
+ * around it, folding those proven to matter into a statistic.
+ * A distance is proven when no extrema out of the region can be nearer, that is when it is not
+ * larger than the distance from the extrema to the sides of the region within the image. An
+ * extrema is also settled when its nearest neighbour, whatever it is, cannot change the statistic.
+ * @param extremas Extremas of the region, with image coordinates, those of the tile first
+ * @param resolved Flag of each extrema of the tile, set once it is settled
+ * @param left First column of the region
+ * @param top First row of the region
+ * @param right Column following the last column of the region
+ * @param bottom Row following the last row of the region
+ * @param largest True for the maximal nearest neighbour distance, false for the minimal one
+ * @param statistic Statistic of the extremas settled so far, updated
+ * @return Number of extremas of the tile still unsettled, whose search must be widened.
+ */
+unsigned int TiledFABEMD::searchNearest(const std::vector<Extrema> & extremas, std::vector<unsigned char> & resolved,
+    unsigned int left, unsigned int top, unsigned int right, unsigned int bottom, bool largest, float & statistic)
+{
+    const float infinity = std::numeric_limits<float>::infinity();
+
+    if (std::find(resolved.begin(), resolved.end(), 0) == resolved.end())
+    {
+        return 0;
+    }
+
+    // The grid is built on coordinates relative to the region, which it then covers
+    _gridExtremas.resize(extremas.size());
+    for (unsigned int i = 0; i < extremas.size(); ++i)
+    {
+        _gridExtremas[i] = Extrema(extremas[i].x() - left, extremas[i].y() - top);
+    }
+    ExtremaGrid & grid = _workspace.grid();
+    grid.build(_gridExtremas, right - left, bottom - top);
+
+    unsigned int unresolved = 0;
+    for (unsigned int i = 0; i < resolved.size(); ++i)
+    {
+        if (resolved[i])
+        {
+            continue;
+        }
+
+        // Extremas out of the region are at least margin pixels away
+        const unsigned int x = extremas[i].x();
+        const unsigned int y = extremas[i].y();
+        float margin = infinity;
+        margin = left > 0 ? std::min(margin, (float)(x - left + 1)) : margin;
+        margin = top > 0 ? std::min(margin, (float)(y - top + 1)) : margin;
+        margin = right < _width ? std::min(margin, (float)(right - x)) : margin;
+        margin = bottom < _height ? std::min(margin, (float)(bottom - y)) : margin;
+
+        float distance = grid.nearestDistance(i);
+        if (distance <= margin)
+        {
+            statistic = largest ? std::max(statistic, distance) : std::min(statistic, distance);
+            resolved[i] = 1;
+        }
+        else if (largest ? distance <= statistic : margin >= statistic)
+        {
+            resolved[i] = 1;
+        }
+        else
+        {
+            ++unresolved;
+        }
+    }
+
+    return unresolved;
+}
+
+/**
+ * @brief Fold the nearest neighbour distances of the extremas of a tile into the statistics of
+ * the BEMC, the extremas of the tile being the first ones of the region maps.
+ * The region searched starts with the tile, and is widened by a halo doubled each time some
+ * extremas of the tile are still unsettled, only the extremas of the added ring being detected.
+ * The extremas around the tile must fit in the memory budget.
+ * @param left First column of the tile
+ * @param top First row of the tile
+ * @param right Column following the last column of the tile
+ * @param bottom Row following the last row of the tile
+ * @param largestMinima True for the maximal distance of the minimas, false for the minimal one
+ * @param largestMaxima True for the maximal distance of the maximas, false for the minimal one
+ */
+void TiledFABEMD::tileNearestDistances(unsigned int left, unsigned int top, unsigned int right, unsigned int bottom,
+    bool largestMinima, bool largestMaxima)
+{
+    const size_t extremaBytes = 2 * sizeof(Extrema) + sizeof(unsigned int);
+    const size_t tileBytes = sizeof(float) * ((size_t)_tileSize + _parameters.size) * (_tileSize + _parameters.size);
+    unsigned int regionLeft = left;
+    unsigned int regionTop = top;
+    unsigned int regionRight = right;
+    unsigned int regionBottom = bottom;
+    unsigned int halo = 0;
+
+    _resolvedMinimas.assign(_regionMinimas.size(), 0);
+    _resolvedMaximas.assign(_regionMaximas.size(), 0);
+    while (true)
+    {
+        // The region maps, their grid copy and its index
+        checkMemory(tileBytes + extremaBytes * (_regionMinimas.size() + _regionMaximas.size()),
+            "the extremas around a tile");
+        unsigned int unresolved = searchNearest(_regionMinimas, _resolvedMinimas,
+            regionLeft, regionTop, regionRight, regionBottom, largestMinima, _minimaDistance);
+        unresolved += searchNearest(_regionMaximas, _resolvedMaximas,
+            regionLeft, regionTop, regionRight, regionBottom, largestMaxima, _maximaDistance);
+        if (unresolved == 0)
+        {
+            break;
+        }
+
+        // Detect the ring between the region and the tile widened by the new halo
+        halo = std::max(16U, 2 * halo);
+        unsigned int newLeft = left - std::min(halo, left);
+        unsigned int newTop = top - std::min(halo, top);
+        unsigned int newRight = right + std::min(halo, _width - right);
+        unsigned int newBottom = bottom + std::min(halo, _height - bottom);
+        detectArea(newLeft, newTop, newRight, regionTop);
+        detectArea(newLeft, regionBottom, newRight, newBottom);
+        detectArea(newLeft, regionTop, regionLeft, regionBottom);
+        detectArea(regionRight, regionTop, newRight, regionBottom);
+        regionLeft = newLeft;
+        regionTop = newTop;
+        regionRight = newRight;
+        regionBottom = newBottom;
+    }
+}
+
+/**
+ * @brief Count the minimas and maximas of the BEMC being sifted, and get the statistics of their
+ * nearest neighbour distances that the filters widths type needs, tile after tile.
+ * Only the statistics are kept, combined over the tiles, so that they are the same as FABEMD's
+ * on the whole image: infinity if there are less than two minimas or maximas.
+ */
+void TiledFABEMD::measureExtremas()
+{
+    bool largestMinima = false;
+    bool largestMaxima = false;
+    const bool distances = FABEMD::nearestDistanceStatistics(_parameters.osfwType, largestMinima, largestMaxima);
+    size_t minimaCount = 0;
+    size_t maximaCount = 0;
+
+    _minimaDistance = largestMinima ? 0.0f : std::numeric_limits<float>::infinity();
+    _maximaDistance = largestMaxima ? 0.0f : std::numeric_limits<float>::infinity();
+    for (unsigned int top = 0; top < _height; top += _tileSize)
+    {
+        for (unsigned int left = 0; left < _width; left += _tileSize)
+        {
+            const unsigned int right = std::min(_width, left + _tileSize);
+            const unsigned int bottom = std::min(_height, top + _tileSize);
+
+            _regionMinimas.clear();
+            _regionMaximas.clear();
+            detectArea(left, top, right, bottom);
+            minimaCount += _regionMinimas.size();
+            maximaCount += _regionMaximas.size();
+            if (distances)
+            {
+                tileNearestDistances(left, top, right, bottom, largestMinima, largestMaxima);
+            }
+        }
+    }
+
+    _extremaCount = (unsigned int)std::min(minimaCount + maximaCount, (size_t)std::numeric_limits<unsigned int>::max());
+    if (minimaCount < 2)
+    {
+        _minimaDistance = std::numeric_limits<float>::infinity();
+    }
+    if (maximaCount < 2)
+    {
+        _maximaDistance = std::numeric_limits<float>::infinity();
+    }
+}
+
+/**
+ * @brief Compute order statistics filter widths, as FABEMD does on the whole image, from the
+ * statistics of measureExtremas().
+ */
+void TiledFABEMD::computeFiltersWidths()
+{
+    FABEMD::filtersWidths(_parameters.osfwType, _minimaDistance, _maximaDistance, std::max(_width, _height),
+        _windowWidthMin, _windowWidthMax);
+}
+
+/**
+ * @brief Run one sifting iteration, tile after tile: compute and smooth both envelopes, subtract
+ * their mean from F_{T_j} into the next BEMC file, and add it to the residue file.
+ * Each tile is loaded with a halo of twice the largest window radius on each side, the envelope
+ * values of the tile depending on the order statistics of the pixels up to one radius away from
+ * it. The tile, its halo and both envelopes must fit in the memory budget.
+ * The variance sums are accumulated in double, as they run over the whole image.
+ * @return Standard deviation of F_{T_{j+1}}.
+ */
+float TiledFABEMD::sift()
+{
+    CImg<float> & bimf = _workspace.bimf();
+    CImg<float> & lower = _workspace.lowerEnvelope();
+    CImg<float> & upper = _workspace.upperEnvelope();
+    CImg<float> & residue = _workspace.residue();
+    const unsigned int radius = std::max(_windowWidthMin, _windowWidthMax) / 2;
+    const unsigned int halo = std::min(2 * radius, std::max(_width, _height));
+    const size_t loadedSize = std::min((size_t)_width, (size_t)_tileSize + 2 * (size_t)halo) *
+        std::min((size_t)_height, (size_t)_tileSize + 2 * (size_t)halo);
+    checkMemory(sizeof(float) * (3 * loadedSize + (size_t)_tileSize * _tileSize), "the tiles and halos sifted");
+
+    double meValue = 0.0;
+    double ftjValue = 0.0;
+    for (unsigned int top = 0; top < _height; top += _tileSize)
+    {
+        for (unsigned int left = 0; left < _width; left += _tileSize)
+        {
+            const unsigned int columnCount = std::min(_width - left, _tileSize);
+            const unsigned int rowCount = std::min(_height - top, _tileSize);
+            unsigned int blockLeft;
+            unsigned int blockTop;
+            loadBlock(*_bimf, left, top, left + columnCount, top + rowCount, halo, bimf, blockLeft, blockTop);
+
+            if (_windowWidthMin == _windowWidthMax)
+            {
+                _workspace.filter().minimumMaximum(bimf, lower, upper, _windowWidthMin);
+            }
+            else
+            {
+                _workspace.filter().minimum(bimf, lower, _windowWidthMin);
+                _workspace.filter().maximum(bimf, upper, _windowWidthMax);
+            }
+            _workspace.filter().average(lower, lower, _windowWidthMin);
+            _workspace.filter().average(upper, upper, _windowWidthMax);
+
+            residue.assign(columnCount, rowCount);
+            _residue->readBlock(left, top, columnCount, rowCount, residue.data());
+
+            for (unsigned int y = 0; y < rowCount; ++y)
+            {
+                float * row = bimf.data(left - blockLeft, top - blockTop + y);
+                const float * lowerRow = lower.data(left - blockLeft, top - blockTop + y);
+                const float * upperRow = upper.data(left - blockLeft, top - blockTop + y);
+                float * residueRow = residue.data(0, y);
+                for (unsigned int x = 0; x < columnCount; ++x)
+                {
+                    const float average = (lowerRow[x] + upperRow[x]) / 2.0f;
+                    meValue += average * average;
+                    ftjValue += row[x] * row[x];
+                    row[x] -= average;
+                    residueRow[x] += average;
+                }
+                _next->writeBlock(left, top + y, columnCount, 1, row);
+            }
+            _residue->writeBlock(left, top, columnCount, rowCount, residue.data());
+        }
+    }
+    std::swap(_bimf, _next);
+
+    return (float)(meValue / ftjValue);
+}
+
+/**
+ * @brief Get the mean of an image file, read tile after tile.
+ * @param file Source file
+ * @return Mean of the pixels.
+ */
+double TiledFABEMD::mean(ImageFile & file)
+{
+    CImg<float> & tile = _workspace.residue();
+    double sum = 0.0;
+
+    for (unsigned int top = 0; top < _height; top += _tileSize)
+    {
+        for (unsigned int left = 0; left < _width; left += _tileSize)
+        {
+            unsigned int blockLeft;
+            unsigned int blockTop;
+            loadBlock(file, left, top, std::min(_width, left + _tileSize), std::min(_height, top + _tileSize), 0,
+                tile, blockLeft, blockTop);
+            cimg_for(tile, value, float)
+            {
+                sum += (double)*value;
+            }
+        }
+    }
+
+    return sum / ((double)_width * _height);
+}
+
+/**
+ * @brief Get the energy of the variations of an image file around a value, read tile after tile.
+ * @param file Source file
+ * @param mean Value around which variations are measured
+ * @return Sum of the squared differences between the pixels and the value.
+ */
+double TiledFABEMD::energy(ImageFile & file, double mean)
+{
+    CImg<float> & tile = _workspace.residue();
+    double sum = 0.0;
+
+    for (unsigned int top = 0; top < _height; top += _tileSize)
+    {
+        for (unsigned int left = 0; left < _width; left += _tileSize)
+        {
+            unsigned int blockLeft;
+            unsigned int blockTop;
+            loadBlock(file, left, top, std::min(_width, left + _tileSize), std::min(_height, top + _tileSize), 0,
+                tile, blockLeft, blockTop);
+            cimg_for(tile, value, float)
+            {
+                sum += (*value - mean) * (*value - mean);
+            }
+        }
+    }
+
+    return sum;
+}
+
+/**
+ * @brief Tell whether the decomposition must stop, the remaining signal being output as residue.
+ * @param bimfCount Number of BEMCs extracted
+ * @return True if the BEMC count or the remaining signal energy limit is reached.
+ */
+bool TiledFABEMD::limitReached(unsigned int bimfCount)
+{
+    if (_parameters.maximumBimfCount > 0 && bimfCount >= _parameters.maximumBimfCount)
+    {
+        return true;
+    }
+
+    return _parameters.energyThreshold > 0.0f &&
+        energy(*_residue, _inputMean) < _parameters.energyThreshold * _inputEnergy;
+}
+
+/**
+ * @brief Delete the work files, those renamed to output files being kept.
+ * @param prefix Path prefix of the output files
+ */
+void TiledFABEMD::removeWorkFiles(const std::string & prefix)
+{
+    for (unsigned int f = 0; f < 3; ++f)
+    {
+        std::ostringstream path;
+        path << prefix << "_work" << f << ".cimg";
+        if (_files[f].filename() == path.str())
+        {
+            _files[f].remove();
+        }
+    }
+}
+
+/**
+ * @brief Compute the BEMCs and the residue into their files, the work files being created.
+ * @param prefix Path prefix of the output files
+ * @return Number of files written.
+ */
+unsigned int TiledFABEMD::decompose(const std::string & prefix)
+{
+    unsigned int count = 0;
+
+    _workspace.detector().setSize(_parameters.size);
+    _workspace.detector().setThreadPool(_threadPool);
+    _workspace.filter().setThreadPool(_threadPool);
+
+    // (i) Set i = 1. Take I and set S_i = I
+    for (unsigned int top = 0; top < _height; top += _tileSize)
+    {
+        for (unsigned int left = 0; left < _width; left += _tileSize)
+        {
+            CImg<float> & tile = _workspace.residue();
+            unsigned int blockLeft;
+            unsigned int blockTop;
+            loadBlock(_input, left, top, std::min(_width, left + _tileSize), std::min(_height, top + _tileSize), 0,
+                tile, blockLeft, blockTop);
+            _residue->writeBlock(left, top, tile.width(), tile.height(), tile.data());
+        }
+    }
+    if (_parameters.energyThreshold > 0.0f)
+    {
+        _inputMean = mean(_input);
+        _inputEnergy = energy(_input, _inputMean);
+    }
+
+    unsigned int i = 1;
+    do
+    {
+        // (ii) Set j = 1. Set F_{T_j} = S_i, the residue file then accumulating the mean envelopes
+        unsigned int j = 1;
+        unsigned int extremas = 0;
+        std::swap(_residue, _bimf);
+        _residue->create(_residue->filename().c_str(), _width, _height);
+        do
+        {
+            // Nearest neighbour distances are only measured when j equals 1, to get the filters widths
+            if (j == 1)
+            {
+                measureExtremas();
+            }
+            else
+            {
+                countExtremas(3);
+            }
+            if (_extremaCount < 3)
+            {
+                if (_verbose)
+                {
+                    std::cout << "BIMF has less than 3 extremas" << std::endl;
+                }
+                break;
+            }
+            if (j == 1)
+            {
+                extremas = _extremaCount;
+                computeFiltersWidths();
+            }
+
+            _variance = sift();
+            if (_verbose)
+            {
+                std::cout << "ITS-BIMF-" << i << "-" << j << ": " << "variance of " << _variance << "." << std::endl;
+            }
+            ++j;
+        } while (_variance > _parameters.threshold && j <= _parameters.maximumAllowableIterations);
+
+        if (_extremaCount < 3)
+        {
+            break;
+        }
+        if (_verbose)
+        {
+            std::cout << "BIMF-" << i << ": " << extremas << " extremas." << std::endl;
+        }
+
+        // Stream the BEMC to its file, and put a new work file in its place
+        std::ostringstream path;
+        path << prefix << "_bimf" << i << ".cimg";
+        std::string workPath = _bimf->filename();
+        _bimf->rename(path.str().c_str());
+        _bimf->create(workPath.c_str(), _width, _height);
+        ++count;
+        ++i;
+
+        // Fold the remaining signal S_i into the residue when a limit is reached
+        if (limitReached(i - 1))
+        {
+            if (_verbose)
+            {
+                std::cout << "Residue kept after " << i - 1 << " BIMFs." << std::endl;
+            }
+            _residue->rename((prefix + "_residue.cimg").c_str());
+            ++count;
+            break;
+        }
+    } while (true);
+
+    return count;
+}
+
+/**
+ * @brief Execute computation of BEMC and residue, streaming each one to a file as it is computed.
+ * BEMCs are written to prefix_bimf1.cimg, prefix_bimf2.cimg..., and the residue, when a BEMC count
+ * or energy limit is reached, to prefix_residue.cimg, as FABEMD::execute() would output them.
+ * Work files prefix_work0.cimg to prefix_work2.cimg are used meanwhile, and deleted at the end,
+ * also when the decomposition fails.
+ * Memory holds a few images of a tile and its halo, the halos growing with the windows, and the
+ * extremas around a tile, within the memory budget.
+ * @param prefix Path prefix of the output files
+ * @return Number of files written.
+ */
+unsigned int TiledFABEMD::execute(const std::string & prefix)
+{
+    unsigned int count = 0;
+
+    try
+    {
+        for (unsigned int f = 0; f < 3; ++f)
+        {
+            std::ostringstream path;
+            path << prefix << "_work" << f << ".cimg";
+            _files[f].create(path.str().c_str(), _width, _height);
+        }
+        count = decompose(prefix);
+    }
+    catch (...)
+    {
+        removeWorkFiles(prefix);
+        throw;
+    }
+    removeWorkFiles(prefix);
+
+    return count;
+}
@@ -0,0 +1,85 @@
+#ifndef __TILED_FABEMD_H__
+#define __TILED_FABEMD_H__
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CImg.h"
+#include "Extrema.h"
+#include "FABEMD.h"
+#include "ImageFile.h"
+#include "ThreadPool.h"
+#include "Workspace.h"
+
+class TiledFABEMD
+{
+private:
+    FABEMD::Parameters _parameters;
+    unsigned int _tileSize;
+    size_t _memoryBudget;
+    unsigned int _width;
+    unsigned int _height;
+    unsigned int _windowWidthMax;
+    unsigned int _windowWidthMin;
+    unsigned int _extremaCount;
+    float _minimaDistance;
+    float _maximaDistance;
+    float _variance;
+    double _inputMean;
+    double _inputEnergy;
+    ThreadPool * _threadPool;
+    bool _verbose;
+
+    ImageFile _input;
+    ImageFile _files[3];
+    ImageFile * _residue;
+    ImageFile * _bimf;
+    ImageFile * _next;
+
+    Workspace _workspace;
+    std::vector<Extrema> _regionMinimas;
+    std::vector<Extrema> _regionMaximas;
+    std::vector<Extrema> _gridExtremas;
+    std::vector<unsigned char> _resolvedMinimas;
+    std::vector<unsigned char> _resolvedMaximas;
+
+    void loadBlock(ImageFile & file, unsigned int left, unsigned int top, unsigned int right, unsigned int bottom,
+        unsigned int halo, cimg_library::CImg<float> & block, unsigned int & blockLeft, unsigned int & blockTop);
+    void detectTile(unsigned int left, unsigned int top, unsigned int right, unsigned int bottom);
+    void detectArea(unsigned int left, unsigned int top, unsigned int right, unsigned int bottom);
+    void checkMemory(size_t bytes, const char * usage) const;
+    void countExtremas(unsigned int limit);
+    unsigned int searchNearest(const std::vector<Extrema> & extremas, std::vector<unsigned char> & resolved,
+        unsigned int left, unsigned int top, unsigned int right, unsigned int bottom, bool largest,
+        float & statistic);
+    void tileNearestDistances(unsigned int left, unsigned int top, unsigned int right, unsigned int bottom,
+        bool largestMinima, bool largestMaxima);
+    void measureExtremas();
+    void computeFiltersWidths();
+    float sift();
+    double mean(ImageFile & file);
+    double energy(ImageFile & file, double mean);
+    bool limitReached(unsigned int bimfCount);
+    void removeWorkFiles(const std::string & prefix);
+    unsigned int decompose(const std::string & prefix);
+
+public:
+    TiledFABEMD(const char * filename, const FABEMD::Parameters & parameters, unsigned int tileSize = 256,
+        size_t memoryBudget = 1024 * 1024 * 1024);
+
+    unsigned int width() const { return this->_width; }
+    unsigned int height() const { return this->_height; }
+    unsigned int tileSize() const { return this->_tileSize; }
+    size_t memoryBudget() const { return this->_memoryBudget; }
+
+    void setThreadPool(ThreadPool * threadPool);
+    void setVerbose(bool verbose);
+    unsigned int execute(const std::string & prefix);
+};
+
+#endif // __TILED_FABEMD_H__
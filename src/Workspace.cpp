@@ -0,0 +1,49 @@
+#include "Workspace.h"
+
+using namespace cimg_library;
+
+/**
+ * @brief Create an empty workspace. Buffers are allocated by reserve().
+ */
+Workspace::Workspace()
+{
+    _width = 0;
+    _height = 0;
+    _depth = 0;
+}
+
+/**
+ * @brief Allocate the images and extrema maps of a decomposition of given size.
+ * Nothing is allocated when the workspace already has this size. The line buffers of the filters
+ * are allocated here for every worker of their thread pool, and those of the nearest extrema
+ * searches grow during the first decomposition only, so that further decompositions of images of
+ * this size do not allocate.
+ * @param width Image width
+ * @param height Image height
+ * @param depth Image depth, 1 for a 2D image
+ */
+void Workspace::reserve(unsigned int width, unsigned int height, unsigned int depth)
+{
+    if (width == _width && height == _height && depth == _depth)
+    {
+        return;
+    }
+    _width = width;
+    _height = height;
+    _depth = depth;
+
+    _residue.assign(width, height, depth);
+    _bimf.assign(width, height, depth);
+    _lowerEnvelope.assign(width, height, depth);
+    _upperEnvelope.assign(width, height, depth);
+
+    // Strict extremas of a kind are never adjacent, so at most one in each 2x2(x2) block
+    std::vector<Extrema>::size_type extremaCapacity =
+        (std::vector<Extrema>::size_type)((width + 1) / 2) * ((height + 1) / 2) * ((depth + 1) / 2);
+    _localMinimas.clear();
+    _localMaximas.clear();
+    _localMinimas.reserve(extremaCapacity);
+    _localMaximas.reserve(extremaCapacity);
+
+    _filter.reserve(std::max(std::max(width, height), depth));
+}
@@ -0,0 +1,54 @@
+#ifndef __WORKSPACE_H__
+#define __WORKSPACE_H__
+
+#include <vector>
+
+#include "CImg.h"
+#include "DistanceTransform.h"
+#include "Extrema.h"
+#include "ExtremaDetector.h"
+#include "ExtremaGrid.h"
+#include "SeparableFilter.h"
+
+class Workspace
+{
+private:
+    unsigned int _width;
+    unsigned int _height;
+    unsigned int _depth;
+
+    cimg_library::CImg<float> _residue;
+    cimg_library::CImg<float> _bimf;
+    cimg_library::CImg<float> _lowerEnvelope;
+    cimg_library::CImg<float> _upperEnvelope;
+
+    std::vector<Extrema> _localMinimas;
+    std::vector<Extrema> _localMaximas;
+
+    ExtremaDetector _detector;
+    ExtremaGrid _grid;
+    DistanceTransform _distanceTransform;
+    SeparableFilter _filter;
+
+public:
+    Workspace();
+
+    void reserve(unsigned int width, unsigned int height, unsigned int depth = 1);
+
+    unsigned int width() const { return this->_width; }
+    unsigned int height() const { return this->_height; }
+    unsigned int depth() const { return this->_depth; }
+
+    cimg_library::CImg<float> & residue() { return this->_residue; }
+    cimg_library::CImg<float> & bimf() { return this->_bimf; }
+    cimg_library::CImg<float> & lowerEnvelope() { return this->_lowerEnvelope; }
+    cimg_library::CImg<float> & upperEnvelope() { return this->_upperEnvelope; }
+    std::vector<Extrema> & localMinimas() { return this->_localMinimas; }
+    std::vector<Extrema> & localMaximas() { return this->_localMaximas; }
+    ExtremaDetector & detector() { return this->_detector; }
+    ExtremaGrid & grid() { return this->_grid; }
+    DistanceTransform & distanceTransform() { return this->_distanceTransform; }
+    SeparableFilter & filter() { return this->_filter; }
+};
+
+#endif // __WORKSPACE_H__